@@ -1,19 +1,209 @@
-#!/usr/bin/env python3
-
-import serial
-import sys
-
-print("python echo script started\n")
-HEX = False
-
-ser = serial.Serial(sys.argv[1], sys.argv[2])
-
-try:
-	while True:
-		sys.stdout.write(ser.read(1).decode(encoding="ISO-8859-1"))
-		sys.stdout.flush()
-except KeyboardInterrupt:
-	print("key exc")
-finally:
-	print('done')
-	ser.close()
\ No newline at end of file
+#!/usr/bin/env python3
+
+import re
+import serial
+import struct
+import sys
+
+# usage: serial_echo.py <port> <baud> [path to Debug_logIds.h]
+# With the message table given, binary log frames (see Debug_log.h) are
+# decoded into text, everything else is echoed as before.
+# Profiler dumps (PROF lines, see profiler.h) are collected and shown as a
+# report sorted by total cycles, I2C trace dumps (I2CT lines, see i2cTrace.h)
+# as a table of the transfers with the names of their status and error codes.
+
+LOG_SYNC = 0xA5
+# id and DEBUG_LOG_MAX_ARGUMENT_BYTES of Debug_log.h, a larger length byte is no frame
+LOG_MAX_LENGTH = 1 + 16
+LOG_MESSAGE = re.compile(r'DEBUG_LOG_MESSAGE\(\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+PROFILE_PREFIX = b"PROF "
+TRACE_PREFIX = b"I2CT "
+TRACE_ADDRESS_RESET = 0xFF
+# TWSR values of i2cInterface_internal.h and the I2C_CODES_* of i2cInterface.h
+TRACE_STATUS = {0x00: "bus error", 0x08: "start", 0x10: "repeated start", 0x18: "SLA+W ack", 0x20: "SLA+W nack",
+	0x28: "data ack", 0x30: "data nack", 0x38: "arbitration lost", 0x40: "SLA+R ack", 0x48: "SLA+R nack",
+	0x50: "read ack", 0x58: "read nack", 0xF8: "no status"}
+TRACE_ERRORS = ["ok", "invalid params", "start failed", "address nack", "data nack", "read failed", "timeout"]
+LOG_SPECIFIER = re.compile(r'%[-+ #0]*\d*(?:\.\d+)?(hh|h|l)?([diuxXcf%])')
+
+def load_messages(path):
+	messages = []
+	with open(path) as header:
+		for name, fmt in LOG_MESSAGE.findall(header.read()):
+			messages.append((name, fmt.encode().decode("unicode_escape")))
+	return messages
+
+def argument_layout(fmt):
+	# argument sizes as avr-gcc passes them: int is 16 bit, long 32 bit
+	layout = ""
+	for length, conversion in LOG_SPECIFIER.findall(fmt):
+		if conversion == "%":
+			continue
+		if conversion == "f":
+			layout += "f"
+		elif conversion == "c" or length == "hh":
+			layout += "b" if conversion == "d" or conversion == "i" else "B"
+		elif length == "l":
+			layout += "l" if conversion == "d" or conversion == "i" else "L"
+		else:
+			layout += "h" if conversion == "d" or conversion == "i" else "H"
+	return "<" + layout
+
+def decode_frame(messages, frame):
+	log_id = frame[0]
+	if log_id >= len(messages):
+		return "[log id %u unknown: %s]\n" % (log_id, frame[1:].hex())
+	name, fmt = messages[log_id]
+	layout = argument_layout(fmt)
+	if struct.calcsize(layout) != len(frame) - 1:
+		return "[%s: %u argument bytes, expected %u]\n" % (name, len(frame) - 1, struct.calcsize(layout))
+	arguments = struct.unpack(layout, frame[1:])
+	conversions = [conversion for length, conversion in LOG_SPECIFIER.findall(fmt) if conversion != "%"]
+	arguments = tuple(chr(value) if conversion == "c" else value for value, conversion in zip(arguments, conversions))
+	# python formatting knows no length modifiers
+	text = LOG_SPECIFIER.sub(lambda match: match.group(0).replace(match.group(1), "", 1) if match.group(1) else match.group(0), fmt)
+	return (text % arguments) + "\n"
+
+class ProfileReport:
+	def __init__(self):
+		self.clock = None
+		self.rows = []
+
+	def line(self, text):
+		fields = text.split()
+		if fields[1] == "BEGIN":
+			self.clock = int(fields[2])
+			self.rows = []
+		elif fields[1] == "END":
+			return self.report()
+		elif len(fields) == 6:
+			self.rows.append((fields[1],) + tuple(int(value) for value in fields[2:]))
+		return ""
+
+	def report(self):
+		if self.clock is None:
+			return ""
+		rows = sorted(self.rows, key=lambda row: row[2], reverse=True)
+		width = max([len(row[0]) for row in rows] + [8])
+		total = sum(row[2] for row in rows) or 1
+		text = "%-*s %8s %12s %10s %10s %10s %6s\n" % (width, "function", "calls", "total us", "avg cyc", "min cyc", "max cyc", "share")
+		for name, calls, cycles, minimum, maximum in rows:
+			text += "%-*s %8u %12.1f %10u %10u %10u %5.1f%%\n" % (width, name, calls, cycles * 1e6 / self.clock, cycles // calls, minimum, maximum, 100.0 * cycles / total)
+		# the functions nest, the share is of the sum of the rows, not of the run time
+		self.clock = None
+		return text
+
+class TraceReport:
+	def __init__(self):
+		self.now = None
+		self.rows = []
+
+	def line(self, text):
+		fields = text.split()
+		if fields[1] == "BEGIN":
+			self.now = int(fields[3])
+			self.rows = []
+		elif fields[1] == "END":
+			return self.report()
+		elif len(fields) == 7:
+			self.rows.append(tuple(int(value, 16 if i in (2, 4) else 10) for i, value in enumerate(fields[1:])))
+		return ""
+
+	def report(self):
+		if self.now is None:
+			return ""
+		text = "%12s %8s %7s %6s  %-18s %s\n" % ("start us", "dur us", "address", "bytes", "status", "result")
+		for start, duration, address, length, status, errorcode in self.rows:
+			if address == TRACE_ADDRESS_RESET:
+				text += "%12u %s\n" % (start, "---- reset ----")
+				continue
+			result = TRACE_ERRORS[errorcode] if errorcode < len(TRACE_ERRORS) else str(errorcode)
+			text += "%12u %8u    0x%02X %6u  %-18s %s\n" % (start, duration, address, length, TRACE_STATUS.get(status, "0x%02X" % status), result)
+		text += "dumped at %uus\n" % self.now
+		self.now = None
+		return text
+
+def held_prefix(pending):
+	for prefix in (PROFILE_PREFIX, TRACE_PREFIX):
+		if pending.startswith(prefix) or prefix.startswith(bytes(pending)):
+			return True
+	return False
+
+def echo(ser, messages):
+	frame = None
+	# start of a text line that may turn out to be a profiler or trace line, held back until that is clear
+	pending = bytearray()
+	line_start = True
+	profile = ProfileReport()
+	trace = TraceReport()
+	# bytes taken for a frame that turned out to be text, they are read again
+	replay = bytearray()
+	while True:
+		if replay:
+			data = bytes(replay[:1])
+			del replay[:1]
+		else:
+			data = ser.read(1)
+		if not data:
+			continue
+		byte = data[0]
+		if frame is None:
+			if messages is not None and byte == LOG_SYNC:
+				frame = bytearray()
+				continue
+			if line_start or pending:
+				pending.append(byte)
+				line_start = False
+				if held_prefix(pending):
+					if byte == ord("\n"):
+						report = profile if pending.startswith(PROFILE_PREFIX) else trace
+						sys.stdout.write(report.line(pending.decode(encoding="ISO-8859-1")))
+						pending = bytearray()
+						line_start = True
+					sys.stdout.flush()
+					continue
+				data = bytes(pending)
+				pending = bytearray()
+			line_start = byte == ord("\n")
+			sys.stdout.write(data.decode(encoding="ISO-8859-1"))
+		else:
+			frame.append(byte)
+			if len(frame) == 1 and (byte == 0 or byte > LOG_MAX_LENGTH):
+				# the sync byte was text, echo it and resync from the length byte on
+				sys.stdout.write((bytes(pending) + bytes([LOG_SYNC])).decode(encoding="ISO-8859-1"))
+				pending = bytearray()
+				line_start = False
+				replay += frame
+				frame = None
+				sys.stdout.flush()
+				continue
+			# frame holds length, id, arguments, checksum
+			if len(frame) < frame[0] + 2:
+				continue
+			checksum = 0
+			for value in frame[:-1]:
+				checksum ^= value
+			if checksum != frame[-1]:
+				sys.stdout.write("[corrupt log frame: %s]\n" % frame.hex())
+			else:
+				sys.stdout.write(decode_frame(messages, frame[1:-1]))
+			frame = None
+		sys.stdout.flush()
+
+print("python echo script started\n")
+HEX = False
+
+messages = None
+if len(sys.argv) > 3:
+	messages = load_messages(sys.argv[3])
+	print("decoding %u log messages from %s\n" % (len(messages), sys.argv[3]))
+
+ser = serial.Serial(sys.argv[1], sys.argv[2])
+
+try:
+	echo(ser, messages)
+except KeyboardInterrupt:
+	print("key exc")
+finally:
+	print('done')
+	ser.close()
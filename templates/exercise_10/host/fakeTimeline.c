@@ -0,0 +1,76 @@
+#ifdef TEST
+
+#include "fakeTimeline.h"
+
+uint32_t fakeTimelineDelayClock = 0;
+uint64_t fakeTimelineBusNanos = 0;
+uint32_t fakeTimelineDelayCalls = 0;
+FakeTimeline_Event fakeTimelineEvents[FAKETIMELINE_MAX_EVENTS];
+uint16_t fakeTimelineLength = 0;
+uint8_t fakeTimelineOverflowed = 0;
+
+void fakeTimeline_reset(void){
+	fakeTimelineLength = 0;
+	fakeTimelineOverflowed = 0;
+	fakeTimelineDelayCalls = 0;
+}
+
+uint32_t fakeTimeline_delayClockMicros(void){
+	return fakeTimelineDelayClock;
+}
+
+uint32_t fakeTimeline_now(void){
+	return fakeTimelineDelayClock + (uint32_t)(fakeTimelineBusNanos / 1000);
+}
+
+void fakeTimeline_delay(uint32_t micros){
+	fakeTimelineDelayCalls++;
+	fakeTimeline_record(FAKETIMELINE_EVENT_DELAY, 0, micros);
+	fakeTimelineDelayClock += micros;
+}
+
+void fakeTimeline_addBusNanos(uint64_t nanos){
+	fakeTimelineBusNanos += nanos;
+}
+
+void fakeTimeline_record(uint8_t type, uint8_t address, uint32_t value){
+	if(fakeTimelineLength == FAKETIMELINE_MAX_EVENTS){
+		fakeTimelineOverflowed = 1;
+		return;
+	}
+	FakeTimeline_Event* event = &fakeTimelineEvents[fakeTimelineLength++];
+	event->micros = fakeTimeline_now();
+	event->type = type;
+	event->address = address;
+	event->value = value;
+}
+
+uint16_t fakeTimeline_getLength(void){
+	return fakeTimelineLength;
+}
+
+FakeTimeline_Event* fakeTimeline_getEvent(uint16_t index){
+	if(index >= fakeTimelineLength){
+		return 0;
+	}
+	return &fakeTimelineEvents[index];
+}
+
+uint8_t fakeTimeline_hasOverflowed(void){
+	return fakeTimelineOverflowed;
+}
+
+uint32_t fakeTimeline_getDelayCalls(void){
+	return fakeTimelineDelayCalls;
+}
+
+int32_t fakeTimeline_find(uint16_t startIndex, uint8_t type, uint32_t valueMask, uint32_t expectedValue){
+	for (uint16_t i = startIndex; i < fakeTimelineLength; ++i){
+		if(fakeTimelineEvents[i].type == type && (fakeTimelineEvents[i].value & valueMask) == expectedValue){
+			return i;
+		}
+	}
+	return -1;
+}
+
+#endif // TEST
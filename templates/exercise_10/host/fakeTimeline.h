@@ -0,0 +1,45 @@
+#ifndef _FAKETIMELINE_H
+#define _FAKETIMELINE_H
+
+#include <stdint.h>
+
+//Virtual time of the TEST build. A wait moves the clock forward in one step, however long it is,
+//and every wait is recorded together with the bus events between the waits, so a host run can check
+//timing rules ("4.1ms after the first 0x03 nibble") against the timeline instead of counting calls.
+
+#define FAKETIMELINE_MAX_EVENTS 4096
+
+#define FAKETIMELINE_EVENT_DELAY 0 //value: requested microseconds
+#define FAKETIMELINE_EVENT_I2C_START 1 //address: slave, value: 1 when acknowledged
+#define FAKETIMELINE_EVENT_I2C_WRITE 2 //value: byte
+#define FAKETIMELINE_EVENT_I2C_READ 3 //value: byte
+#define FAKETIMELINE_EVENT_I2C_STOP 4
+#define FAKETIMELINE_EVENT_I2C_TIMEOUT 5
+#define FAKETIMELINE_EVENT_LATCH 6 //address: device, value: expander pins at the falling edge of EN, D7..D4 in the upper nibble
+
+typedef struct{
+	uint32_t micros; //delay clock plus bus time
+	uint8_t type;
+	uint8_t address;
+	uint32_t value;
+}FakeTimeline_Event;
+
+//Clears the recorded events, the clock keeps running
+void fakeTimeline_reset(void);
+//Time spent in waits only, the time base of delayAbstraction.c
+uint32_t fakeTimeline_delayClockMicros(void);
+//Waits and bus transfers, the time the emulated devices see
+uint32_t fakeTimeline_now(void);
+void fakeTimeline_delay(uint32_t micros);
+void fakeTimeline_addBusNanos(uint64_t nanos);
+void fakeTimeline_record(uint8_t type, uint8_t address, uint32_t value);
+
+uint16_t fakeTimeline_getLength(void);
+FakeTimeline_Event* fakeTimeline_getEvent(uint16_t index);
+//More events than FAKETIMELINE_MAX_EVENTS since the last reset, the later ones are missing
+uint8_t fakeTimeline_hasOverflowed(void);
+uint32_t fakeTimeline_getDelayCalls(void);
+//Index of the first event from startIndex on with the type and (value & valueMask) == expectedValue, -1 when none
+int32_t fakeTimeline_find(uint16_t startIndex, uint8_t type, uint32_t valueMask, uint32_t expectedValue);
+
+#endif // _FAKETIMELINE_H
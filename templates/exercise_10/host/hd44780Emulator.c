@@ -0,0 +1,580 @@
+#ifdef TEST
+
+#include "hd44780Emulator.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "i2cInterface.h"
+#include "i2cInterface_internal.h"
+#include "delayAbstraction.h"
+#include "fakeTimeline.h"
+
+Hd44780Emulator_Device emulatedDevices[HD44780EMULATOR_MAX_DEVICES];
+Hd44780Emulator_Statistics emulatorStatistics;
+uint32_t emulatorStatisticsStartMicros = 0;
+uint64_t emulatorStatisticsStartBusNanos = 0;
+uint64_t emulatorTotalBusNanos = 0;
+I2C_Registers* emulatorRegisters = 0;
+uint32_t emulatorClockspeed = 100000L;
+//clock of the transfer on the bus, the default or the setting of the slave
+uint32_t emulatorTransferClockspeed = 100000L;
+I2C_ClockSetting* emulatorSlaveClockSetting = 0;
+
+uint8_t emulatorByteLog[HD44780EMULATOR_BYTELOG_SIZE];
+uint16_t emulatorByteLogLength = 0;
+
+uint8_t emulatorSlaveAddress = 0;
+Hd44780Emulator_Device* emulatorOpenDevice = 0;
+uint8_t emulatorTransactionOpen = 0;
+
+uint32_t emulatorTimeoutMicros = I2C_DEFAULT_TIMEOUT_US;
+uint16_t emulatorErrorCounts[I2C_CODES_COUNT];
+uint8_t emulatorBusStuck = 0;
+
+//##################################
+//HD44780 model
+uint32_t hd44780EmulatorInternal_now(void){
+	//bus time is not part of the delay clock, the timeline adds it so back to back transfers are timed correctly
+	return fakeTimeline_now();
+}
+
+void hd44780EmulatorInternal_addBusBits(uint32_t bits){
+	uint64_t nanos = bits * 1000000000ULL / emulatorTransferClockspeed;
+	emulatorTotalBusNanos += nanos;
+	fakeTimeline_addBusNanos(nanos);
+}
+
+uint8_t hd44780EmulatorInternal_fail(uint8_t errorcode){
+	emulatorStatistics.failedTransactions++;
+	if(emulatorErrorCounts[errorcode] != 0xFFFF){
+		emulatorErrorCounts[errorcode]++;
+	}
+	return errorcode;
+}
+
+//The transfer waits out the timeout, then the target recovers the bus with nine clock pulses and a STOP
+uint8_t hd44780EmulatorInternal_timeOut(void){
+	uint64_t nanos = (emulatorTimeoutMicros + (2 * I2C_RECOVERY_CLOCK_PULSES + 4) * I2C_RECOVERY_HALF_PERIOD_US) * 1000ULL;
+	emulatorTotalBusNanos += nanos;
+	fakeTimeline_addBusNanos(nanos);
+	fakeTimeline_record(FAKETIMELINE_EVENT_I2C_TIMEOUT, emulatorSlaveAddress, 0);
+	emulatorStatistics.busRecoveries++;
+	emulatorBusStuck = 0;
+	emulatorTransactionOpen = 0;
+	emulatorOpenDevice = 0;
+	return hd44780EmulatorInternal_fail(I2C_CODES_TIMEOUT);
+}
+
+uint8_t hd44780EmulatorInternal_ddramIndex(Hd44780Emulator_Device* device, uint8_t address){
+	if(device->twoLines){
+		if(address >= 0x40){
+			return HD44780EMULATOR_LINE_LENGTH + ((address - 0x40) % HD44780EMULATOR_LINE_LENGTH);
+		}
+		return address % HD44780EMULATOR_LINE_LENGTH;
+	}
+	return address % HD44780EMULATOR_DDRAM_SIZE;
+}
+
+void hd44780EmulatorInternal_moveAddressCounter(Hd44780Emulator_Device* device, uint8_t increment){
+	if(device->addressInCgram){
+		device->addressCounter = (device->addressCounter + (increment ? 1 : -1)) & (HD44780EMULATOR_CGRAM_SIZE - 1);
+		return;
+	}
+	uint8_t address = device->addressCounter;
+	if(device->twoLines){
+		//0x27 continues at 0x40 and 0x67 at 0x00
+		if(increment){
+			address = (address == 0x27) ? 0x40 : (address == 0x67) ? 0x00 : address + 1;
+		}
+		else{
+			address = (address == 0x40) ? 0x27 : (address == 0x00) ? 0x67 : address - 1;
+		}
+	}
+	else{
+		address = increment ? (address + 1) % HD44780EMULATOR_DDRAM_SIZE : (address + HD44780EMULATOR_DDRAM_SIZE - 1) % HD44780EMULATOR_DDRAM_SIZE;
+	}
+	device->addressCounter = address;
+}
+
+uint8_t hd44780EmulatorInternal_lineLength(Hd44780Emulator_Device* device){
+	//in 1-line mode the whole DDRAM forms a single line
+	return device->twoLines ? HD44780EMULATOR_LINE_LENGTH : HD44780EMULATOR_DDRAM_SIZE;
+}
+
+void hd44780EmulatorInternal_shiftDisplay(Hd44780Emulator_Device* device, uint8_t toTheRight){
+	//shifting the content left moves the visible window to higher addresses
+	uint8_t lineLength = hd44780EmulatorInternal_lineLength(device);
+	if(toTheRight){
+		device->displayShift = (device->displayShift + lineLength - 1) % lineLength;
+	}
+	else{
+		device->displayShift = (device->displayShift + 1) % lineLength;
+	}
+}
+
+void hd44780EmulatorInternal_executeInstruction(Hd44780Emulator_Device* device, uint8_t instruction){
+	uint32_t executionTime = HD44780EMULATOR_EXECUTION_TIME_US;
+	if(instruction & 0x80){
+		device->addressCounter = instruction & 0x7F;
+		device->addressInCgram = 0;
+	}
+	else if(instruction & 0x40){
+		device->addressCounter = instruction & 0x3F;
+		device->addressInCgram = 1;
+	}
+	else if(instruction & 0x20){
+		device->fourBitMode = !(instruction & 0x10);
+		device->twoLines = (instruction & 0x08) != 0;
+		device->font5x10 = (instruction & 0x04) != 0;
+	}
+	else if(instruction & 0x10){
+		if(instruction & 0x08){
+			hd44780EmulatorInternal_shiftDisplay(device, instruction & 0x04);
+		}
+		else{
+			hd44780EmulatorInternal_moveAddressCounter(device, instruction & 0x04);
+		}
+	}
+	else if(instruction & 0x08){
+		device->displayOn = (instruction & 0x04) != 0;
+		device->cursorOn = (instruction & 0x02) != 0;
+		device->blinkOn = (instruction & 0x01) != 0;
+	}
+	else if(instruction & 0x04){
+		device->entryIncrement = (instruction & 0x02) != 0;
+		device->entryShift = (instruction & 0x01) != 0;
+	}
+	else if(instruction & 0x02){
+		device->addressCounter = 0;
+		device->addressInCgram = 0;
+		device->displayShift = 0;
+		executionTime = HD44780EMULATOR_EXECUTION_TIME_CLEAR_US;
+	}
+	else if(instruction & 0x01){
+		memset(device->ddram, ' ', HD44780EMULATOR_DDRAM_SIZE);
+		device->addressCounter = 0;
+		device->addressInCgram = 0;
+		device->displayShift = 0;
+		device->entryIncrement = 1;
+		executionTime = HD44780EMULATOR_EXECUTION_TIME_CLEAR_US;
+	}
+	device->busyUntilMicros = hd44780EmulatorInternal_now() + executionTime;
+}
+
+void hd44780EmulatorInternal_writeData(Hd44780Emulator_Device* device, uint8_t data){
+	if(device->addressInCgram){
+		device->cgram[device->addressCounter & (HD44780EMULATOR_CGRAM_SIZE - 1)] = data;
+	}
+	else{
+		device->ddram[hd44780EmulatorInternal_ddramIndex(device, device->addressCounter)] = data;
+		if(device->entryShift){
+			hd44780EmulatorInternal_shiftDisplay(device, !device->entryIncrement);
+		}
+	}
+	hd44780EmulatorInternal_moveAddressCounter(device, device->entryIncrement);
+	device->dataWrites++;
+	device->busyUntilMicros = hd44780EmulatorInternal_now() + HD44780EMULATOR_EXECUTION_TIME_US;
+}
+
+void hd44780EmulatorInternal_latch(Hd44780Emulator_Device* device, uint8_t pins){
+	if(pins & HD44780EMULATOR_PIN_RW){
+		return;
+	}
+	fakeTimeline_record(FAKETIMELINE_EVENT_LATCH, device->address, pins);
+	uint8_t nibble = pins >> 4;
+	uint8_t value;
+	if(device->fourBitMode){
+		if(!device->nibblePending){
+			device->pendingHighNibble = nibble;
+			device->nibblePending = 1;
+			return;
+		}
+		device->nibblePending = 0;
+		value = (device->pendingHighNibble << 4) | nibble;
+	}
+	else{
+		//8-bit interface: only D7..D4 are wired, D3..D0 read as zero
+		value = nibble << 4;
+	}
+
+	if((int32_t)(hd44780EmulatorInternal_now() - device->busyUntilMicros) < 0){
+		device->timingViolations++;
+	}
+	if(pins & HD44780EMULATOR_PIN_RS){
+		hd44780EmulatorInternal_writeData(device, value);
+	}
+	else{
+		device->instructions++;
+		hd44780EmulatorInternal_executeInstruction(device, value);
+	}
+}
+
+//Busy flag and address counter with RS low, the addressed RAM cell with RS high
+void hd44780EmulatorInternal_startRead(Hd44780Emulator_Device* device, uint8_t pins){
+	uint8_t value;
+	if(pins & HD44780EMULATOR_PIN_RS){
+		value = device->addressInCgram ? device->cgram[device->addressCounter & (HD44780EMULATOR_CGRAM_SIZE - 1)] : device->ddram[hd44780EmulatorInternal_ddramIndex(device, device->addressCounter)];
+	}
+	else{
+		uint8_t busy = (int32_t)(hd44780EmulatorInternal_now() - device->busyUntilMicros) < 0;
+		value = (busy << 7) | (device->addressCounter & 0x7F);
+	}
+	if(device->fourBitMode && device->readLowNibbleNext){
+		device->readPins = (value & 0x0F) << 4;
+	}
+	else{
+		device->readPins = value & 0xF0;
+	}
+	device->readLowNibbleNext = device->fourBitMode && !device->readLowNibbleNext;
+	if(!device->readLowNibbleNext){
+		device->reads++;
+		//a RAM read moves the address counter like a write
+		if(pins & HD44780EMULATOR_PIN_RS){
+			hd44780EmulatorInternal_moveAddressCounter(device, device->entryIncrement);
+		}
+	}
+}
+
+void hd44780EmulatorInternal_writeExpander(Hd44780Emulator_Device* device, uint8_t data){
+	uint8_t previous = device->expanderOutput;
+	device->expanderOutput = data;
+	if(!(previous & HD44780EMULATOR_PIN_EN) && (data & HD44780EMULATOR_PIN_EN) && (data & HD44780EMULATOR_PIN_RW)){
+		hd44780EmulatorInternal_startRead(device, data);
+	}
+	//the controller latches on the falling edge of EN, with the lines set up before it
+	if((previous & HD44780EMULATOR_PIN_EN) && !(data & HD44780EMULATOR_PIN_EN)){
+		hd44780EmulatorInternal_latch(device, previous);
+	}
+	if(emulatorByteLogLength < HD44780EMULATOR_BYTELOG_SIZE){
+		emulatorByteLog[emulatorByteLogLength++] = data;
+	}
+}
+
+//##################################
+//Emulator API
+void hd44780Emulator_reset(void){
+	memset(emulatedDevices, 0, sizeof(emulatedDevices));
+	emulatorRegisters = 0;
+	emulatorOpenDevice = 0;
+	emulatorTransactionOpen = 0;
+	emulatorBusStuck = 0;
+	fakeTimeline_reset();
+	hd44780Emulator_resetStatistics();
+}
+
+void hd44780Emulator_holdBus(void){
+	emulatorBusStuck = 1;
+}
+
+Hd44780Emulator_Device* hd44780Emulator_attach(uint8_t address){
+	Hd44780Emulator_Device* device = hd44780Emulator_getDevice(address);
+	if(device){
+		return device;
+	}
+	for (uint8_t i = 0; i < HD44780EMULATOR_MAX_DEVICES; ++i){
+		device = &emulatedDevices[i];
+		if(device->attached){
+			continue;
+		}
+		//power-on state of the controller: 8-bit interface, display off, increment
+		memset(device, 0, sizeof(*device));
+		memset(device->ddram, ' ', HD44780EMULATOR_DDRAM_SIZE);
+		device->attached = 1;
+		device->address = address;
+		device->entryIncrement = 1;
+		return device;
+	}
+	return 0;
+}
+
+Hd44780Emulator_Device* hd44780Emulator_getDevice(uint8_t address){
+	for (uint8_t i = 0; i < HD44780EMULATOR_MAX_DEVICES; ++i){
+		if(emulatedDevices[i].attached && emulatedDevices[i].address == address){
+			return &emulatedDevices[i];
+		}
+	}
+	return 0;
+}
+
+void hd44780Emulator_getLine(uint8_t address, uint8_t row, uint8_t columns, char* buffer){
+	Hd44780Emulator_Device* device = hd44780Emulator_getDevice(address);
+	for (uint8_t column = 0; column < columns; ++column){
+		if(device == 0 || !device->displayOn){
+			buffer[column] = ' ';
+			continue;
+		}
+		uint8_t lineAddress = (column + device->displayShift) % hd44780EmulatorInternal_lineLength(device);
+		buffer[column] = device->ddram[hd44780EmulatorInternal_ddramIndex(device, (row ? 0x40 : 0x00) + lineAddress)];
+	}
+	buffer[columns] = '\0';
+}
+
+void hd44780Emulator_printScreen(uint8_t address, uint8_t columns, uint8_t rows){
+	char line[HD44780EMULATOR_LINE_LENGTH + 1];
+	printf("+");
+	for (uint8_t column = 0; column < columns; ++column){
+		printf("-");
+	}
+	printf("+\n");
+	for (uint8_t row = 0; row < rows; ++row){
+		hd44780Emulator_getLine(address, row, columns, line);
+		//CGRAM characters are shown as their slot number
+		for (uint8_t column = 0; column < columns; ++column){
+			if((uint8_t)line[column] < 8){
+				line[column] = '0' + line[column];
+			}
+		}
+		printf("|%s|\n", line);
+	}
+	printf("+");
+	for (uint8_t column = 0; column < columns; ++column){
+		printf("-");
+	}
+	printf("+\n");
+}
+
+void hd44780Emulator_resetStatistics(void){
+	memset(&emulatorStatistics, 0, sizeof(emulatorStatistics));
+	emulatorByteLogLength = 0;
+	emulatorStatisticsStartMicros = delayAbstraction_nowMicros();
+	emulatorStatisticsStartBusNanos = emulatorTotalBusNanos;
+}
+
+void hd44780Emulator_getStatistics(Hd44780Emulator_Statistics* statistics){
+	*statistics = emulatorStatistics;
+	statistics->delayMicros = delayAbstraction_nowMicros() - emulatorStatisticsStartMicros;
+	statistics->busMicros = (uint32_t)((emulatorTotalBusNanos - emulatorStatisticsStartBusNanos) / 1000);
+}
+
+//Nine clock periods per byte (eight bits and the acknowledge), START and STOP about one each
+uint32_t hd44780Emulator_estimateBusMicros(Hd44780Emulator_Statistics* statistics, uint32_t clockspeed){
+	uint64_t bits = 9ULL * (statistics->addressBytes + statistics->bytesWritten + statistics->bytesRead) + 2ULL * statistics->transactions;
+	return (uint32_t)(bits * 1000000ULL / clockspeed);
+}
+
+uint32_t hd44780Emulator_getClockspeed(void){
+	return emulatorClockspeed;
+}
+
+uint8_t* hd44780Emulator_getByteLog(uint16_t* length){
+	*length = emulatorByteLogLength;
+	return emulatorByteLog;
+}
+
+//##################################
+//i2cInterface.h implementation
+uint8_t i2c_init(I2C_Registers* i2cRegisters, uint32_t clockspeed){
+	if(i2cRegisters == 0){
+		return I2C_FUNCTIONCODES_INVALID_PARAMS;
+	}
+	//like on the target a bus that runs already is left alone
+	if(i2cRegisters == emulatorRegisters){
+		return I2C_FUNCTIONCODES_NO_ERROR;
+	}
+	I2C_ClockSetting setting;
+	uint8_t errorcode = i2c_computeClockSetting(clockspeed, &setting, &emulatorClockspeed);
+	if(errorcode){
+		return errorcode;
+	}
+	emulatorRegisters = i2cRegisters;
+	emulatorTransferClockspeed = emulatorClockspeed;
+	emulatorSlaveClockSetting = 0;
+	emulatorTransactionOpen = 0;
+	emulatorOpenDevice = 0;
+	return I2C_FUNCTIONCODES_NO_ERROR;
+}
+
+uint32_t i2c_getClockspeed(void){
+	return emulatorClockspeed;
+}
+
+void i2c_setSlaveAddress(uint8_t addressToSet){
+	emulatorSlaveAddress = addressToSet;
+}
+
+void i2c_setSlaveClockSetting(I2C_ClockSetting* setting){
+	emulatorSlaveClockSetting = setting;
+}
+
+uint8_t i2c_sendStartCondition(void){
+	emulatorTransferClockspeed = emulatorSlaveClockSetting ? i2cInternal_getClockRate(emulatorSlaveClockSetting) : emulatorClockspeed;
+	emulatorStatistics.transactions++;
+	emulatorStatistics.addressBytes++;
+	if(emulatorBusStuck){
+		return hd44780EmulatorInternal_timeOut();
+	}
+	hd44780EmulatorInternal_addBusBits(10);
+	emulatorOpenDevice = hd44780Emulator_getDevice(emulatorSlaveAddress);
+	fakeTimeline_record(FAKETIMELINE_EVENT_I2C_START, emulatorSlaveAddress, emulatorOpenDevice != 0);
+	if(emulatorOpenDevice == 0){
+		emulatorTransactionOpen = 0;
+		hd44780EmulatorInternal_addBusBits(1);
+		return hd44780EmulatorInternal_fail(I2C_CODES_SLAVE_ADDR_TRANSMIT_FAILED);
+	}
+	emulatorTransactionOpen = 1;
+	return I2C_CODES_NO_ERROR;
+}
+
+void i2c_sendStopCondition(void){
+	if(emulatorTransactionOpen){
+		hd44780EmulatorInternal_addBusBits(1);
+		fakeTimeline_record(FAKETIMELINE_EVENT_I2C_STOP, emulatorSlaveAddress, 0);
+	}
+	emulatorTransactionOpen = 0;
+	emulatorOpenDevice = 0;
+}
+
+uint8_t i2c_write(uint8_t data){
+	return i2c_writeBytes(&data, 1);
+}
+
+uint8_t i2c_writeBytes(uint8_t* data, uint8_t dataLength){
+	if(!emulatorTransactionOpen){
+		return hd44780EmulatorInternal_fail(I2C_CODES_START_CONDITION_FAILED);
+	}
+	if(emulatorBusStuck){
+		return hd44780EmulatorInternal_timeOut();
+	}
+	for (uint8_t i = 0; i < dataLength; ++i){
+		emulatorStatistics.bytesWritten++;
+		hd44780EmulatorInternal_addBusBits(9);
+		fakeTimeline_record(FAKETIMELINE_EVENT_I2C_WRITE, emulatorSlaveAddress, data[i]);
+		hd44780EmulatorInternal_writeExpander(emulatorOpenDevice, data[i]);
+	}
+	return I2C_CODES_NO_ERROR;
+}
+
+uint8_t i2c_readBytes(uint8_t* dataBuffer, uint16_t dataLength){
+	//a read needs its own address byte with the read bit
+	if(emulatorBusStuck){
+		return hd44780EmulatorInternal_timeOut();
+	}
+	emulatorStatistics.addressBytes++;
+	hd44780EmulatorInternal_addBusBits(10);
+	Hd44780Emulator_Device* device = hd44780Emulator_getDevice(emulatorSlaveAddress);
+	if(device == 0){
+		return hd44780EmulatorInternal_fail(I2C_CODES_SLAVE_ADDR_TRANSMIT_FAILED);
+	}
+	emulatorTransactionOpen = 1;
+	emulatorOpenDevice = device;
+	for (uint16_t i = 0; i < dataLength; ++i){
+		emulatorStatistics.bytesRead++;
+		hd44780EmulatorInternal_addBusBits(9);
+		//the PCF8574 outputs are quasi-bidirectional: a pin written low reads low, a pin written high reads what drives it
+		uint8_t pins = device->expanderOutput;
+		if((pins & HD44780EMULATOR_PIN_RW) && (pins & HD44780EMULATOR_PIN_EN)){
+			pins &= device->readPins | 0x0F;
+		}
+		dataBuffer[i] = pins;
+		fakeTimeline_record(FAKETIMELINE_EVENT_I2C_READ, emulatorSlaveAddress, pins);
+	}
+	return I2C_CODES_NO_ERROR;
+}
+
+uint8_t i2c_read(){
+	uint8_t data = 0;
+	i2c_readBytes(&data, 1);
+	return data;
+}
+
+//The expanders have no registers, the register byte is just the first byte written.
+//Like on the target these run at the clock given to i2c_init.
+int8_t i2c_writeToRegister(uint8_t deviceAddress, uint8_t registerAddress, uint8_t *data, uint16_t dataLength){
+	I2C_Transaction transaction = {0};
+	transaction.slaveAddress = deviceAddress;
+	transaction.flags = I2C_TRANSACTION_FLAG_REGISTER;
+	transaction.registerAddress = registerAddress;
+	transaction.txBuffer = data;
+	transaction.txLength = dataLength;
+	uint8_t errorcode = i2c_submitTransaction(&transaction);
+	if(errorcode){
+		return errorcode;
+	}
+	return i2c_waitForTransaction(&transaction);
+}
+
+int8_t i2c_readFromRegister(uint8_t deviceAddress, uint8_t registerAddress, uint8_t* dataBuffer, uint16_t dataLength){
+	I2C_Transaction transaction = {0};
+	transaction.slaveAddress = deviceAddress;
+	transaction.flags = I2C_TRANSACTION_FLAG_REGISTER;
+	transaction.registerAddress = registerAddress;
+	transaction.rxBuffer = dataBuffer;
+	transaction.rxLength = dataLength;
+	uint8_t errorcode = i2c_submitTransaction(&transaction);
+	if(errorcode){
+		return errorcode;
+	}
+	return i2c_waitForTransaction(&transaction);
+}
+
+//Transactions complete synchronously on the host
+uint8_t i2c_submitTransaction(I2C_Transaction* transaction){
+	if(transaction == 0 || (transaction->txLength && transaction->txBuffer == 0) || (transaction->rxLength && transaction->rxBuffer == 0)){
+		return I2C_CODES_INVALID_PARAMS;
+	}
+	uint8_t errorcode = I2C_CODES_NO_ERROR;
+	//the piecewise functions do the work, the slave set up for them is restored afterwards
+	uint8_t slaveAddress = emulatorSlaveAddress;
+	I2C_ClockSetting* slaveClockSetting = emulatorSlaveClockSetting;
+	emulatorSlaveAddress = transaction->slaveAddress;
+	emulatorSlaveClockSetting = transaction->clockSetting;
+	if(!(transaction->flags & I2C_TRANSACTION_FLAG_NO_START)){
+		errorcode = i2c_sendStartCondition();
+	}
+	if(!errorcode && (transaction->flags & I2C_TRANSACTION_FLAG_REGISTER)){
+		errorcode = i2c_write(transaction->registerAddress);
+	}
+	if(!errorcode && transaction->txLength){
+		for (uint16_t i = 0; i < transaction->txLength && !errorcode; ++i){
+			errorcode = i2c_write(transaction->txBuffer[i]);
+		}
+	}
+	if(!errorcode && transaction->rxLength){
+		errorcode = i2c_readBytes(transaction->rxBuffer, transaction->rxLength);
+	}
+	if(errorcode || !(transaction->flags & I2C_TRANSACTION_FLAG_NO_STOP)){
+		i2c_sendStopCondition();
+	}
+	emulatorSlaveAddress = slaveAddress;
+	emulatorSlaveClockSetting = slaveClockSetting;
+	transaction->errorcode = errorcode;
+	transaction->state = I2C_TRANSACTION_STATE_DONE;
+	if(transaction->callback){
+		transaction->callback(transaction);
+	}
+	return I2C_CODES_NO_ERROR;
+}
+
+uint8_t i2c_isTransactionDone(I2C_Transaction* transaction){
+	return transaction->state == I2C_TRANSACTION_STATE_DONE;
+}
+
+uint8_t i2c_waitForTransaction(I2C_Transaction* transaction){
+	return transaction->errorcode;
+}
+
+uint8_t i2c_isIdle(void){
+	return 1;
+}
+
+void i2c_setTimeout(uint32_t timeoutMicros){
+	emulatorTimeoutMicros = timeoutMicros;
+}
+
+//Transfers time out inside the call that runs them, nothing is left pending
+void i2c_checkTimeout(void){
+}
+
+uint16_t i2c_getErrorCount(uint8_t errorcode){
+	if(errorcode >= I2C_CODES_COUNT){
+		return 0;
+	}
+	return emulatorErrorCounts[errorcode];
+}
+
+void i2c_resetErrorCounts(void){
+	memset(emulatorErrorCounts, 0, sizeof(emulatorErrorCounts));
+}
+
+#endif // TEST
@@ -0,0 +1,78 @@
+#ifndef _HD44780EMULATOR_H
+#define _HD44780EMULATOR_H
+
+#include <stdint.h>
+
+//Host-side model of HD44780 controllers behind PCF8574 expanders, used as the i2cInterface.h
+//implementation of the TEST build. It decodes the expander bytes into 4-bit HD44780 instructions,
+//keeps DDRAM, CGRAM, cursor and display state, and counts the bus traffic and virtual time.
+
+#define HD44780EMULATOR_MAX_DEVICES 8
+#define HD44780EMULATOR_DDRAM_SIZE 80
+#define HD44780EMULATOR_CGRAM_SIZE 64
+#define HD44780EMULATOR_LINE_LENGTH 40
+#define HD44780EMULATOR_BYTELOG_SIZE 512
+
+//PCF8574 pin mapping of the common backpacks
+#define HD44780EMULATOR_PIN_RS 0x01
+#define HD44780EMULATOR_PIN_RW 0x02
+#define HD44780EMULATOR_PIN_EN 0x04
+#define HD44780EMULATOR_PIN_BACKLIGHT 0x08
+
+#define HD44780EMULATOR_EXECUTION_TIME_US 37
+#define HD44780EMULATOR_EXECUTION_TIME_CLEAR_US 1520
+
+typedef struct{
+	uint8_t attached;
+	uint8_t address;
+	uint8_t expanderOutput;
+	uint8_t fourBitMode;
+	uint8_t nibblePending;
+	uint8_t pendingHighNibble;
+	uint8_t readLowNibbleNext; //4-bit reads also come in two EN pulses, high nibble first
+	uint8_t readPins; //D7..D4 driven by the controller while RW and EN are high
+	uint8_t ddram[HD44780EMULATOR_DDRAM_SIZE];
+	uint8_t cgram[HD44780EMULATOR_CGRAM_SIZE];
+	uint8_t addressCounter;
+	uint8_t addressInCgram;
+	uint8_t entryIncrement;
+	uint8_t entryShift;
+	uint8_t displayOn;
+	uint8_t cursorOn;
+	uint8_t blinkOn;
+	uint8_t twoLines;
+	uint8_t font5x10;
+	uint8_t displayShift;
+	uint32_t busyUntilMicros;
+	uint32_t instructions;
+	uint32_t dataWrites;
+	uint32_t reads;
+	uint32_t timingViolations;
+}Hd44780Emulator_Device;
+
+typedef struct{
+	uint32_t transactions;
+	uint32_t failedTransactions;
+	uint32_t busRecoveries;
+	uint32_t addressBytes;
+	uint32_t bytesWritten;
+	uint32_t bytesRead;
+	uint32_t delayMicros; //virtual time spent in delayAbstraction waits
+	uint32_t busMicros; //bus time at the clock of each transfer
+}Hd44780Emulator_Statistics;
+
+void hd44780Emulator_reset(void);
+Hd44780Emulator_Device* hd44780Emulator_attach(uint8_t address);
+Hd44780Emulator_Device* hd44780Emulator_getDevice(uint8_t address);
+//A slave holds SDA low until the next transfer times out and recovers the bus
+void hd44780Emulator_holdBus(void);
+void hd44780Emulator_getLine(uint8_t address, uint8_t row, uint8_t columns, char* buffer);
+void hd44780Emulator_printScreen(uint8_t address, uint8_t columns, uint8_t rows);
+
+void hd44780Emulator_resetStatistics(void);
+void hd44780Emulator_getStatistics(Hd44780Emulator_Statistics* statistics);
+uint32_t hd44780Emulator_estimateBusMicros(Hd44780Emulator_Statistics* statistics, uint32_t clockspeed);
+uint32_t hd44780Emulator_getClockspeed(void);
+uint8_t* hd44780Emulator_getByteLog(uint16_t* length);
+
+#endif // _HD44780EMULATOR_H
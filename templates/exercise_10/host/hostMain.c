@@ -0,0 +1,193 @@
+#if defined(TEST) && !defined(LCD_BENCHMARK)
+
+#include <stdio.h>
+#include <string.h>
+
+#include "i2cInterface.h"
+#include "lcdScreenDriver.h"
+#include "delayAbstraction.h"
+#include "hd44780Emulator.h"
+#include "memoryAbstraction.h"
+#include "fakeTimeline.h"
+
+#define SCREEN_ADDRESS 0x27
+#define SECOND_SCREEN_ADDRESS 0x26
+#define THIRD_SCREEN_ADDRESS 0x25
+#define NUMBER_OF_COLUMNS 16
+#define NUMBER_OF_ROWS 2
+#define HOST_MARQUEE_STEPS 30
+//HD44780 datasheet: the second 0x3 of the power-on sequence no earlier than 4.1ms after the first
+#define HOST_POWER_ON_GAP_US 4100
+
+//The host counterpart of exampleMain.c for the compileLocal/runLocal targets.
+//The driver talks to the emulated display, every step prints its bus cost and the screen content.
+
+typedef struct{
+	uint8_t address;
+	const char* rows[NUMBER_OF_ROWS];
+}HostMain_ExpectedScreen;
+
+//What the displays show at the end, the visible cells of the emulated DDRAM with the display shift applied
+const HostMain_ExpectedScreen hostExpectedScreens[] = {
+	{SCREEN_ADDRESS, {"Hello Embedded  ", "XYABrecovered   "}},
+	{SECOND_SCREEN_ADDRESS, {"Display 2       ", "-21.5C 003f  7  "}},
+	//30 marquee shifts moved both lines of the third display
+	{THIRD_SCREEN_ADDRESS, {"          Displa", "orty DDRAM colum"}},
+};
+
+const uint8_t hostHeartGlyph[LCDSCREEN_GLYPH_ROWS_5x8] MEMORYABSTRACTION_PROGMEM = {0x00, 0x0A, 0x1F, 0x1F, 0x0E, 0x04, 0x00, 0x00};
+
+I2C_Registers hostI2CRegisters;
+LcdScreenDriver_Context hostScreen;
+LcdScreenDriver_Context secondScreen;
+LcdScreenDriver_Context thirdScreen;
+
+void hostMain_reportStep(const char* stepName){
+	Hd44780Emulator_Statistics statistics;
+	hd44780Emulator_getStatistics(&statistics);
+	printf("%-32s transactions %5u  bytes %5u  delay %8uus  bus %8uus\n", stepName, statistics.transactions, statistics.addressBytes + statistics.bytesWritten + statistics.bytesRead, statistics.delayMicros, statistics.busMicros);
+	hd44780Emulator_resetStatistics();
+}
+
+uint32_t hostMain_checkRow(uint8_t address, uint8_t row, const char* expected){
+	char line[NUMBER_OF_COLUMNS + 1];
+	hd44780Emulator_getLine(address, row, NUMBER_OF_COLUMNS, line);
+	if(strcmp(line, expected) != 0){
+		printf("0x%02X row %u: expected |%s| shows |%s|\n", address, row, expected, line);
+		return 1;
+	}
+	return 0;
+}
+
+uint32_t hostMain_checkScreen(const HostMain_ExpectedScreen* expected){
+	uint32_t mismatches = 0;
+	for (uint8_t row = 0; row < NUMBER_OF_ROWS; ++row){
+		mismatches += hostMain_checkRow(expected->address, row, expected->rows[row]);
+	}
+	return mismatches;
+}
+
+//Gap between the first 0x3 command nibble of a display and the nibble after it, checked on the timeline
+uint32_t hostMain_powerOnGap(uint8_t address){
+	int32_t first = -1;
+	for (int32_t i = 0; (i = fakeTimeline_find(i, FAKETIMELINE_EVENT_LATCH, 0xF1, 0x30)) >= 0; ++i){
+		if(fakeTimeline_getEvent(i)->address == address){
+			first = i;
+			break;
+		}
+	}
+	for (int32_t i = first + 1; first >= 0 && (i = fakeTimeline_find(i, FAKETIMELINE_EVENT_LATCH, 0, 0)) >= 0; ++i){
+		if(fakeTimeline_getEvent(i)->address == address){
+			return fakeTimeline_getEvent(i)->micros - fakeTimeline_getEvent(first)->micros;
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char const *argv[]){
+	hd44780Emulator_reset();
+	hd44780Emulator_attach(SCREEN_ADDRESS);
+
+	lcdScreenDriver_initialise(&hostScreen, &hostI2CRegisters, SCREEN_ADDRESS, NUMBER_OF_COLUMNS, NUMBER_OF_ROWS, LCDSCREEN_TYPE_5x8DOTS);
+	hostMain_reportStep("initialise");
+	lcdScreenDriver_initialiseScreenToKnownState(&hostScreen);
+	hostMain_reportStep("initialiseScreenToKnownState");
+	uint32_t powerOnGap = hostMain_powerOnGap(SCREEN_ADDRESS);
+	printf("power-on gap after the first 0x3 nibble %uus, %u waits on the timeline\n", powerOnGap, fakeTimeline_getDelayCalls());
+	lcdScreenDriver_setBacklightOn(&hostScreen);
+	hostMain_reportStep("setBacklightOn");
+	lcdScreenDriver_setCursorOn(&hostScreen);
+	hostMain_reportStep("setCursorOn");
+	lcdScreenDriver_clearDisplay(&hostScreen);
+	hostMain_reportStep("clearDisplay");
+	lcdScreenDriver_setCursorHome(&hostScreen);
+	hostMain_reportStep("setCursorHome");
+
+	lcdScreenDriver_printString_P(&hostScreen, MEMORYABSTRACTION_FLASH_STRING("Hello Embedded\nSystems!"));
+	hostMain_reportStep("printString_P");
+	lcdScreenDriver_printChar(&hostScreen, 'A');
+	hostMain_reportStep("printChar");
+	lcdScreenDriver_bufferSetChar(&hostScreen, NUMBER_OF_COLUMNS - 1, 1, 'B');
+	lcdScreenDriver_flush(&hostScreen);
+	hostMain_reportStep("bufferSetChar + flush");
+	lcdScreenDriver_bufferSetGlyph(&hostScreen, NUMBER_OF_COLUMNS - 1, 0, hostHeartGlyph);
+	lcdScreenDriver_flush(&hostScreen);
+	hostMain_reportStep("bufferSetGlyph + flush");
+	//already in CGRAM, only the cell is written
+	lcdScreenDriver_bufferSetGlyph(&hostScreen, NUMBER_OF_COLUMNS - 2, 0, hostHeartGlyph);
+	lcdScreenDriver_flush(&hostScreen);
+	hostMain_reportStep("resident glyph + flush");
+
+	//two more displays on the same bus, all three served by one flushAll
+	hd44780Emulator_attach(SECOND_SCREEN_ADDRESS);
+	hd44780Emulator_attach(THIRD_SCREEN_ADDRESS);
+	lcdScreenDriver_initialise(&secondScreen, &hostI2CRegisters, SECOND_SCREEN_ADDRESS, NUMBER_OF_COLUMNS, NUMBER_OF_ROWS, LCDSCREEN_TYPE_5x8DOTS);
+	lcdScreenDriver_initialiseScreenToKnownState(&secondScreen);
+	lcdScreenDriver_initialise(&thirdScreen, &hostI2CRegisters, THIRD_SCREEN_ADDRESS, NUMBER_OF_COLUMNS, NUMBER_OF_ROWS, LCDSCREEN_TYPE_5x8DOTS);
+	lcdScreenDriver_initialiseScreenToKnownState(&thirdScreen);
+	hd44780Emulator_resetStatistics();
+	lcdScreenDriver_clearDisplay(&secondScreen);
+	lcdScreenDriver_bufferPrintFormat_P(&secondScreen, 0, 0, MEMORYABSTRACTION_FLASH_STRING("Display %u"), 2);
+	lcdScreenDriver_bufferPrintFormat_P(&secondScreen, 0, 1, MEMORYABSTRACTION_FLASH_STRING("%5.1dC %04x%3d"), -215, 0x3F, 7);
+	lcdScreenDriver_bufferPrintString_P(&thirdScreen, 0, 0, MEMORYABSTRACTION_FLASH_STRING("Display 3"));
+	lcdScreenDriver_bufferSetChar(&hostScreen, NUMBER_OF_COLUMNS - 2, 1, 'C');
+	LcdScreenDriver_Context* screens[] = {&hostScreen, &secondScreen, &thirdScreen};
+	lcdScreenDriver_flushAll(screens, 3);
+	hostMain_reportStep("flushAll over three displays");
+
+	//the third display scrolls a text longer than its DDRAM line with shift commands
+	lcdScreenDriver_setMarqueeText(&thirdScreen, 1, "Marquee text longer than the forty DDRAM columns of a line ... ");
+	hostMain_reportStep("setMarqueeText");
+	lcdScreenDriver_startMarquee(&thirdScreen, 0);
+	for (uint8_t step = 0; step < HOST_MARQUEE_STEPS; ++step){
+		lcdScreenDriver_serviceMarquee(&thirdScreen);
+	}
+	hostMain_reportStep("serviceMarquee steps");
+
+	//an MCU reset with the displays powered: the context survived, the first display picks up where it was
+	lcdScreenDriver_initialise(&hostScreen, &hostI2CRegisters, SCREEN_ADDRESS, NUMBER_OF_COLUMNS, NUMBER_OF_ROWS, LCDSCREEN_TYPE_5x8DOTS);
+	lcdScreenDriver_initialiseScreenWarm(&hostScreen, 0);
+	hostMain_reportStep("initialiseScreenWarm");
+	lcdScreenDriver_bufferPrintString(&hostScreen, 0, 0, "Hello Embedded");
+	lcdScreenDriver_bufferPrintString(&hostScreen, 0, 1, "Warm restart");
+	lcdScreenDriver_flush(&hostScreen);
+	hostMain_reportStep("redraw after warm start");
+
+	//a slave holds SDA low: the transfer times out, the bus is recovered and the next flush redraws the display
+	hd44780Emulator_holdBus();
+	lcdScreenDriver_bufferPrintString(&hostScreen, 0, 1, "Bus recovered");
+	lcdScreenDriver_flush(&hostScreen);
+	hostMain_reportStep("flush on a held bus");
+	printf("last error %u, timeouts %u\n", lcdScreenDriver_getLastError(&hostScreen), i2c_getErrorCount(I2C_CODES_TIMEOUT));
+	lcdScreenDriver_flush(&hostScreen);
+	hostMain_reportStep("flush after the timeout");
+
+	//a character written directly fails on the bus: the next one still goes to its own cell, the flush repairs the lost one
+	uint32_t contentMismatches = 0;
+	lcdScreenDriver_setCursorPosition(&hostScreen, 0, 1);
+	lcdScreenDriver_printString(&hostScreen, "XY");
+	hd44780Emulator_holdBus();
+	lcdScreenDriver_printChar(&hostScreen, 'A');
+	lcdScreenDriver_printChar(&hostScreen, 'B');
+	hostMain_reportStep("printChar on a held bus");
+	contentMismatches += hostMain_checkRow(SCREEN_ADDRESS, 1, "XYsBrecovered   ");
+	lcdScreenDriver_flush(&hostScreen);
+	hostMain_reportStep("flush after the failed printChar");
+
+	DelayAbstraction_PowerStatistics power;
+	delayAbstraction_getPowerStatistics(&power);
+	printf("asleep %uus in %u waits, awake %uus\n", power.asleepMicros, power.sleeps, power.awakeMicros);
+
+	uint32_t timingViolations = 0;
+	for (uint8_t i = 0; i < sizeof(hostExpectedScreens) / sizeof(hostExpectedScreens[0]); ++i){
+		uint8_t address = hostExpectedScreens[i].address;
+		hd44780Emulator_printScreen(address, NUMBER_OF_COLUMNS, NUMBER_OF_ROWS);
+		Hd44780Emulator_Device* device = hd44780Emulator_getDevice(address);
+		printf("0x%02X: instructions %u, data writes %u, timing violations %u\n", address, device->instructions, device->dataWrites, device->timingViolations);
+		timingViolations += device->timingViolations;
+		contentMismatches += hostMain_checkScreen(&hostExpectedScreens[i]);
+	}
+	return (timingViolations || contentMismatches || powerOnGap < HOST_POWER_ON_GAP_US) ? 1 : 0;
+}
+
+#endif // TEST && !LCD_BENCHMARK
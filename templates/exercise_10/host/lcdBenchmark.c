@@ -0,0 +1,257 @@
+#if defined(TEST) && defined(LCD_BENCHMARK)
+
+#include <stdio.h>
+#include <string.h>
+
+#include "i2cInterface.h"
+#include "lcdScreenDriver.h"
+#include "delayAbstraction.h"
+#include "hd44780Emulator.h"
+#include "memoryAbstraction.h"
+
+#define SCREEN_ADDRESS 0x27
+#define NUMBER_OF_COLUMNS 16
+#define NUMBER_OF_ROWS 2
+
+#define BENCHMARK_STANDARD_CLOCK 100000UL
+#define BENCHMARK_FAST_CLOCK 400000UL
+#define BENCHMARK_TICKER_STEPS 32
+#define BENCHMARK_BAR_FRAMES 16
+
+//Fixed workloads against the emulated display, run with "make runBenchmark".
+//bus_us is the bus time at the clock each transfer really ran at, the 100kHz and 400kHz columns are estimates
+//from the byte counts. Results go to stdout as a table and to the file given as first argument as CSV, one line per workload,
+//so that runs of different releases can be compared.
+
+typedef void (*Benchmark_Workload)(void);
+
+//Bar graph cells with one to five pixel columns filled
+const uint8_t benchmarkBarGlyphs[5][LCDSCREEN_GLYPH_ROWS_5x8] MEMORYABSTRACTION_PROGMEM = {
+	{0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10},
+	{0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18},
+	{0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C},
+	{0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E},
+	{0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},
+};
+
+I2C_Registers benchmarkI2CRegisters;
+LcdScreenDriver_Context benchmarkScreen;
+char benchmarkTickerText[] = "+++ Embedded Systems ticker, bus cost per step +++ ";
+uint8_t benchmarkDigit = 0;
+
+void benchmark_prepareScreen(void){
+	lcdScreenDriver_initialise(&benchmarkScreen, &benchmarkI2CRegisters, SCREEN_ADDRESS, NUMBER_OF_COLUMNS, NUMBER_OF_ROWS, LCDSCREEN_TYPE_5x8DOTS);
+	lcdScreenDriver_initialiseScreenToKnownState(&benchmarkScreen);
+	lcdScreenDriver_setBacklightOn(&benchmarkScreen);
+	lcdScreenDriver_clearDisplay(&benchmarkScreen);
+	lcdScreenDriver_bufferPrintString(&benchmarkScreen, 0, 0, "Temperature  21C");
+	lcdScreenDriver_bufferPrintString(&benchmarkScreen, 0, 1, "Humidity     45%");
+	lcdScreenDriver_flush(&benchmarkScreen);
+}
+
+void benchmark_initSequence(void){
+	lcdScreenDriver_initialise(&benchmarkScreen, &benchmarkI2CRegisters, SCREEN_ADDRESS, NUMBER_OF_COLUMNS, NUMBER_OF_ROWS, LCDSCREEN_TYPE_5x8DOTS);
+	lcdScreenDriver_initialiseScreenToKnownState(&benchmarkScreen);
+}
+
+//A reset that left the display powered, the context kept its signature
+void benchmark_warmRestart(void){
+	lcdScreenDriver_initialise(&benchmarkScreen, &benchmarkI2CRegisters, SCREEN_ADDRESS, NUMBER_OF_COLUMNS, NUMBER_OF_ROWS, LCDSCREEN_TYPE_5x8DOTS);
+	lcdScreenDriver_initialiseScreenWarm(&benchmarkScreen, 0);
+	lcdScreenDriver_bufferPrintString(&benchmarkScreen, 0, 0, "Temperature  21C");
+	lcdScreenDriver_bufferPrintString(&benchmarkScreen, 0, 1, "Humidity     45%");
+	lcdScreenDriver_flush(&benchmarkScreen);
+}
+
+void benchmark_clearDisplay(void){
+	lcdScreenDriver_clearDisplay(&benchmarkScreen);
+	lcdScreenDriver_setCursorHome(&benchmarkScreen);
+}
+
+void benchmark_fullRedrawDirect(void){
+	lcdScreenDriver_setCursorPosition(&benchmarkScreen, 0, 0);
+	lcdScreenDriver_printString(&benchmarkScreen, "Temperature  22C");
+	lcdScreenDriver_setCursorPosition(&benchmarkScreen, 0, 1);
+	lcdScreenDriver_printString(&benchmarkScreen, "Humidity     46%");
+}
+
+void benchmark_fullRedrawCharacterwise(void){
+	char* lines[] = {"Temperature  23C", "Humidity     47%"};
+	for (uint8_t row = 0; row < NUMBER_OF_ROWS; ++row){
+		for (uint8_t column = 0; column < NUMBER_OF_COLUMNS; ++column){
+			lcdScreenDriver_setCursorPosition(&benchmarkScreen, column, row);
+			lcdScreenDriver_printChar(&benchmarkScreen, lines[row][column]);
+		}
+	}
+}
+
+//every cell differs from the prepared screen, the flush cannot skip any of them
+void benchmark_fullRedrawFramebuffer(void){
+	lcdScreenDriver_bufferPrintString(&benchmarkScreen, 0, 0, "Pressure 1013hPa");
+	lcdScreenDriver_bufferPrintString(&benchmarkScreen, 0, 1, "Dew point:12.5 C");
+	lcdScreenDriver_flush(&benchmarkScreen);
+}
+
+void benchmark_singleDigitDirect(void){
+	lcdScreenDriver_setCursorPosition(&benchmarkScreen, 14, 0);
+	lcdScreenDriver_printChar(&benchmarkScreen, '0' + (benchmarkDigit++ % 10));
+}
+
+void benchmark_singleDigitFramebuffer(void){
+	//the whole screen is redrawn into the buffer, only the digit differs from the panel
+	lcdScreenDriver_bufferPrintString(&benchmarkScreen, 0, 0, "Temperature  2 C");
+	lcdScreenDriver_bufferPrintString(&benchmarkScreen, 0, 1, "Humidity     48%");
+	lcdScreenDriver_bufferSetChar(&benchmarkScreen, 14, 0, '0' + (benchmarkDigit++ % 10));
+	lcdScreenDriver_flush(&benchmarkScreen);
+}
+
+void benchmark_scrollingTicker(void){
+	uint8_t textLength = strlen(benchmarkTickerText);
+	char window[NUMBER_OF_COLUMNS + 1];
+	for (uint8_t step = 0; step < BENCHMARK_TICKER_STEPS; ++step){
+		for (uint8_t column = 0; column < NUMBER_OF_COLUMNS; ++column){
+			window[column] = benchmarkTickerText[(step + column) % textLength];
+		}
+		window[NUMBER_OF_COLUMNS] = '\0';
+		lcdScreenDriver_bufferPrintString(&benchmarkScreen, 0, 1, window);
+		lcdScreenDriver_flush(&benchmarkScreen);
+	}
+}
+
+//The same ticker with hardware display shifts, the text is longer than the DDRAM line so steps also refill a column
+void benchmark_marqueeTicker(void){
+	lcdScreenDriver_setMarqueeText(&benchmarkScreen, 1, benchmarkTickerText);
+	lcdScreenDriver_startMarquee(&benchmarkScreen, 0);
+	for (uint8_t step = 0; step < BENCHMARK_TICKER_STEPS; ++step){
+		lcdScreenDriver_serviceMarquee(&benchmarkScreen);
+	}
+}
+
+//A level meter on the second row: full cells, one partial cell, blanks
+void benchmark_barGraph(void){
+	for (uint8_t frame = 0; frame < BENCHMARK_BAR_FRAMES; ++frame){
+		uint8_t level = (frame * 37) % (NUMBER_OF_COLUMNS * 5);
+		for (uint8_t column = 0; column < NUMBER_OF_COLUMNS; ++column){
+			uint8_t columnStart = column * 5;
+			if(level >= columnStart + 5){
+				lcdScreenDriver_bufferSetGlyph(&benchmarkScreen, column, 1, benchmarkBarGlyphs[4]);
+			}
+			else if(level > columnStart){
+				lcdScreenDriver_bufferSetGlyph(&benchmarkScreen, column, 1, benchmarkBarGlyphs[level - columnStart - 1]);
+			}
+			else{
+				lcdScreenDriver_bufferSetChar(&benchmarkScreen, column, 1, ' ');
+			}
+		}
+		lcdScreenDriver_flush(&benchmarkScreen);
+	}
+}
+
+void benchmark_clearAndRedraw(void){
+	lcdScreenDriver_clearDisplay(&benchmarkScreen);
+	lcdScreenDriver_bufferPrintString(&benchmarkScreen, 0, 0, "Temperature  25C");
+	lcdScreenDriver_bufferPrintString(&benchmarkScreen, 0, 1, "Humidity     49%");
+	lcdScreenDriver_flush(&benchmarkScreen);
+}
+
+void benchmark_clearAndRedrawBusyFlag(void){
+	lcdScreenDriver_setBusyFlagPolling(&benchmarkScreen, 1);
+	benchmark_clearAndRedraw();
+	lcdScreenDriver_setBusyFlagPolling(&benchmarkScreen, 0);
+}
+
+void benchmark_fullRedrawFastMode(void){
+	lcdScreenDriver_setI2CClock(&benchmarkScreen, BENCHMARK_FAST_CLOCK, 0);
+	benchmark_fullRedrawDirect();
+	lcdScreenDriver_setI2CClock(&benchmarkScreen, LCDSCREEN_I2C_CLOCK, 0);
+}
+
+//UI layers that each set the state they need, most of it already in place
+void benchmark_layeredState(void){
+	lcdScreenDriver_setBacklightOn(&benchmarkScreen);
+	lcdScreenDriver_setCursorOn(&benchmarkScreen);
+	lcdScreenDriver_setBlinkOn(&benchmarkScreen);
+	lcdScreenDriver_setTextFlow(&benchmarkScreen, LCDSCREEN_TEXTFLOW_LEFTTORIGHT);
+	lcdScreenDriver_setCursorPosition(&benchmarkScreen, 13, 0);
+	lcdScreenDriver_printString(&benchmarkScreen, "26C");
+	lcdScreenDriver_setCursorPosition(&benchmarkScreen, 0, 1);
+	lcdScreenDriver_setCursorOff(&benchmarkScreen);
+	lcdScreenDriver_setBlinkOff(&benchmarkScreen);
+}
+
+void benchmark_layeredStateBatched(void){
+	lcdScreenDriver_beginUpdate(&benchmarkScreen);
+	benchmark_layeredState();
+	lcdScreenDriver_commitUpdate(&benchmarkScreen);
+}
+
+typedef struct{
+	const char* name;
+	Benchmark_Workload workload;
+	uint8_t prepareScreen;
+}Benchmark_Case;
+
+Benchmark_Case benchmarkCases[] = {
+	{"initSequence", benchmark_initSequence, 0},
+	{"warmRestart", benchmark_warmRestart, 1},
+	{"clearDisplay", benchmark_clearDisplay, 1},
+	{"fullRedrawDirect", benchmark_fullRedrawDirect, 1},
+	{"fullRedrawFastMode", benchmark_fullRedrawFastMode, 1},
+	{"fullRedrawCharacterwise", benchmark_fullRedrawCharacterwise, 1},
+	{"fullRedrawFramebuffer", benchmark_fullRedrawFramebuffer, 1},
+	{"singleDigitDirect", benchmark_singleDigitDirect, 1},
+	{"singleDigitFramebuffer", benchmark_singleDigitFramebuffer, 1},
+	{"scrollingTicker", benchmark_scrollingTicker, 1},
+	{"marqueeTicker", benchmark_marqueeTicker, 1},
+	{"barGraphGlyphs", benchmark_barGraph, 1},
+	{"clearAndRedraw", benchmark_clearAndRedraw, 1},
+	{"clearAndRedrawBusyFlag", benchmark_clearAndRedrawBusyFlag, 1},
+	{"layeredState", benchmark_layeredState, 1},
+	{"layeredStateBatched", benchmark_layeredStateBatched, 1},
+};
+
+int main(int argc, char const *argv[]){
+	FILE* csv = 0;
+	if(argc > 1){
+		csv = fopen(argv[1], "w");
+		if(csv == 0){
+			fprintf(stderr, "cannot open %s\n", argv[1]);
+			return 1;
+		}
+		fprintf(csv, "workload,transactions,bytes,delay_us,bus_us,bus_us_100khz,bus_us_400khz,wall_us_100khz,wall_us_400khz,timing_violations\n");
+	}
+	printf("%-24s %12s %8s %10s %10s %14s %14s %10s\n", "workload", "transactions", "bytes", "delay_us", "bus_us", "wall_us_100k", "wall_us_400k", "violations");
+
+	uint8_t failed = 0;
+	for (uint8_t i = 0; i < sizeof(benchmarkCases) / sizeof(benchmarkCases[0]); ++i){
+		Benchmark_Case* benchmarkCase = &benchmarkCases[i];
+		hd44780Emulator_reset();
+		Hd44780Emulator_Device* device = hd44780Emulator_attach(SCREEN_ADDRESS);
+		if(benchmarkCase->prepareScreen){
+			benchmark_prepareScreen();
+		}
+		uint32_t violationsBefore = device->timingViolations;
+		hd44780Emulator_resetStatistics();
+
+		benchmarkCase->workload();
+
+		Hd44780Emulator_Statistics statistics;
+		hd44780Emulator_getStatistics(&statistics);
+		uint32_t bytes = statistics.addressBytes + statistics.bytesWritten + statistics.bytesRead;
+		uint32_t busStandard = hd44780Emulator_estimateBusMicros(&statistics, BENCHMARK_STANDARD_CLOCK);
+		uint32_t busFast = hd44780Emulator_estimateBusMicros(&statistics, BENCHMARK_FAST_CLOCK);
+		uint32_t violations = device->timingViolations - violationsBefore;
+		failed |= violations != 0;
+
+		printf("%-24s %12u %8u %10u %10u %14u %14u %10u\n", benchmarkCase->name, statistics.transactions, bytes, statistics.delayMicros, statistics.busMicros, statistics.delayMicros + busStandard, statistics.delayMicros + busFast, violations);
+		if(csv){
+			fprintf(csv, "%s,%u,%u,%u,%u,%u,%u,%u,%u,%u\n", benchmarkCase->name, statistics.transactions, bytes, statistics.delayMicros, statistics.busMicros, busStandard, busFast, statistics.delayMicros + busStandard, statistics.delayMicros + busFast, violations);
+		}
+	}
+	if(csv){
+		fclose(csv);
+	}
+	return failed;
+}
+
+#endif // TEST && LCD_BENCHMARK
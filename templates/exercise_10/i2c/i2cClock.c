@@ -0,0 +1,33 @@
+#include "i2cInterface.h"
+#include "i2cInterface_internal.h"
+
+//Shared by the target driver and the host emulator, pure arithmetic on F_CPU
+
+uint8_t i2c_computeClockSetting(uint32_t clockspeed, I2C_ClockSetting* setting, uint32_t* actualClockspeed){
+	if(setting == 0 || clockspeed == 0 || clockspeed > I2C_MAX_CLOCKSPEED){
+		return I2C_FUNCTIONCODES_INVALID_PARAMS;
+	}
+	//CPU cycles per SCL period, rounded up so the bus never runs faster than requested
+	uint32_t cyclesPerBit = (F_CPU + clockspeed - 1) / clockspeed;
+	if(cyclesPerBit < 16){
+		return I2C_FUNCTIONCODES_INVALID_PARAMS;
+	}
+	//the smallest prescaler that fits TWBR leaves the finest steps
+	for (uint8_t prescalerBits = 0; prescalerBits < 4; ++prescalerBits){
+		uint32_t divider = 2UL << (2 * prescalerBits);
+		uint32_t bitRate = (cyclesPerBit - 16 + divider - 1) / divider;
+		if(bitRate <= 0xFF){
+			setting->bitRate = (uint8_t) bitRate;
+			setting->prescalerBits = prescalerBits;
+			if(actualClockspeed){
+				*actualClockspeed = i2cInternal_getClockRate(setting);
+			}
+			return I2C_FUNCTIONCODES_NO_ERROR;
+		}
+	}
+	return I2C_FUNCTIONCODES_INVALID_PARAMS;
+}
+
+uint32_t i2cInternal_getClockRate(I2C_ClockSetting* setting){
+	return F_CPU / (16 + ((uint32_t) setting->bitRate << (1 + 2 * setting->prescalerBits)));
+}
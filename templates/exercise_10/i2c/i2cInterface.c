@@ -0,0 +1,475 @@
+#ifndef TEST
+
+#include "i2cInterface.h"
+#include "i2cInterface_internal.h"
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "registerAbstraction.h"
+#include "i2cRegisterBinding.h"
+#include "delayAbstraction.h"
+#include "profiler.h"
+#include "i2cTrace.h"
+
+#define I2C_CONTROL_CONTINUE ((1 << I2C_BIT_INT) | (1 << I2C_BIT_ENABLE) | (1 << I2C_BIT_INTERRUPT_ENABLE))
+
+I2C_Registers* i2cRegisters = 0;
+uint8_t i2cSlaveAddress;
+I2C_ClockSetting* i2cSlaveClockSetting = 0;
+I2C_ClockSetting i2cDefaultClockSetting;
+uint32_t i2cClockspeed = 0;
+
+//Transactions are executed one after the other from the TWI interrupt, the head is the active one
+I2C_Transaction* volatile i2cQueueHead = 0;
+I2C_Transaction* volatile i2cQueueTail = 0;
+volatile uint16_t i2cWriteIndex;
+volatile uint16_t i2cReadIndex;
+volatile uint8_t i2cReadPhase;
+volatile uint8_t i2cBusHeld = 0;
+
+//Restarted on every step of the bus, the active transfer is aborted when it runs out
+uint32_t i2cTimeoutMicros = I2C_DEFAULT_TIMEOUT_US;
+DelayAbstraction_Timeout i2cProgressTimeout;
+volatile uint16_t i2cErrorCounts[I2C_CODES_COUNT];
+
+#ifdef I2C_TRACE
+//Start and last TWI status of the active transaction for its trace entry
+uint32_t i2cTraceStartMicros;
+volatile uint8_t i2cTraceLastStatus;
+#endif
+
+uint8_t i2c_init(I2C_Registers* registers, uint32_t clockspeed){
+	if(registers == 0){
+		return I2C_FUNCTIONCODES_INVALID_PARAMS;
+	}
+	//the bus is running already, setting it up again would drop the queued and the active transaction
+	if(registers == i2cRegisters){
+		return I2C_FUNCTIONCODES_NO_ERROR;
+	}
+	uint8_t errorcode = i2c_computeClockSetting(clockspeed, &i2cDefaultClockSetting, &i2cClockspeed);
+	if(errorcode){
+		return errorcode;
+	}
+
+	i2cRegisters = registers;
+	I2C_TRACE_INITIALISE();
+	i2cSlaveClockSetting = 0;
+	i2cQueueHead = 0;
+	i2cQueueTail = 0;
+	i2cBusHeld = 0;
+
+	//SDA and SCL as inputs with the internal pull-ups enabled
+	abstraction_setRegisterBitsLow(I2C_REGISTER_PULLUP_DIRECTION, (1 << I2C_PIN_SDA) | (1 << I2C_PIN_SCL));
+	abstraction_setRegisterBitsHigh(I2C_REGISTER_PULLUP_PORT, (1 << I2C_PIN_SDA) | (1 << I2C_PIN_SCL));
+
+	abstraction_setRegisterToValue(I2C_REGISTER_STATUS, i2cDefaultClockSetting.prescalerBits);
+	abstraction_setRegisterToValue(I2C_REGISTER_BAUDRATE, i2cDefaultClockSetting.bitRate);
+	abstraction_setRegisterToValue(I2C_REGISTER_CONTROL, (1 << I2C_BIT_ENABLE));
+	return I2C_FUNCTIONCODES_NO_ERROR;
+}
+
+uint32_t i2c_getClockspeed(void){
+	return i2cClockspeed;
+}
+
+void i2c_setSlaveAddress(uint8_t addressToSet){
+	i2cSlaveAddress = addressToSet;
+}
+
+void i2c_setSlaveClockSetting(I2C_ClockSetting* setting){
+	i2cSlaveClockSetting = setting;
+}
+
+uint8_t i2c_sendStartCondition(void){
+	PROFILE_BEGIN(PROFILE_I2C_START);
+	uint8_t errorcode = i2cInternal_runBlocking(I2C_TRANSACTION_FLAG_NO_STOP, 0, 0, 0, 0);
+	PROFILE_END(PROFILE_I2C_START);
+	return errorcode;
+}
+
+void i2c_sendStopCondition(void){
+	PROFILE_BEGIN(PROFILE_I2C_STOP);
+	i2cInternal_runBlocking(I2C_TRANSACTION_FLAG_NO_START, 0, 0, 0, 0);
+	PROFILE_END(PROFILE_I2C_STOP);
+}
+
+uint8_t i2c_write(uint8_t data){
+	return i2c_writeBytes(&data, 1);
+}
+
+uint8_t i2c_writeBytes(uint8_t* data, uint8_t dataLength){
+	PROFILE_BEGIN(PROFILE_I2C_WRITE);
+	uint8_t errorcode = i2cInternal_runBlocking(I2C_TRANSACTION_FLAG_NO_START | I2C_TRANSACTION_FLAG_NO_STOP, data, dataLength, 0, 0);
+	PROFILE_END(PROFILE_I2C_WRITE);
+	return errorcode;
+}
+
+//Reads with a (repeated) START and SLA+R, the bus stays open until i2c_sendStopCondition
+uint8_t i2c_readBytes(uint8_t* dataBuffer, uint16_t dataLength){
+	uint8_t flags = I2C_TRANSACTION_FLAG_NO_STOP;
+	if(i2cBusHeld){
+		flags |= I2C_TRANSACTION_FLAG_NO_START;
+	}
+	PROFILE_BEGIN(PROFILE_I2C_READ);
+	uint8_t errorcode = i2cInternal_runBlocking(flags, 0, 0, dataBuffer, dataLength);
+	PROFILE_END(PROFILE_I2C_READ);
+	return errorcode;
+}
+
+uint8_t i2c_read(){
+	uint8_t data = 0;
+	i2c_readBytes(&data, 1);
+	return data;
+}
+
+int8_t i2c_writeToRegister(uint8_t deviceAddress, uint8_t registerAddress, uint8_t *data, uint16_t dataLength){
+	I2C_Transaction transaction = {0};
+	transaction.slaveAddress = deviceAddress;
+	transaction.flags = I2C_TRANSACTION_FLAG_REGISTER;
+	transaction.registerAddress = registerAddress;
+	transaction.txBuffer = data;
+	transaction.txLength = dataLength;
+	uint8_t errorcode = i2c_submitTransaction(&transaction);
+	if(errorcode){
+		return errorcode;
+	}
+	return i2c_waitForTransaction(&transaction);
+}
+
+int8_t i2c_readFromRegister(uint8_t deviceAddress, uint8_t registerAddress, uint8_t* dataBuffer, uint16_t dataLength){
+	I2C_Transaction transaction = {0};
+	transaction.slaveAddress = deviceAddress;
+	transaction.flags = I2C_TRANSACTION_FLAG_REGISTER;
+	transaction.registerAddress = registerAddress;
+	transaction.rxBuffer = dataBuffer;
+	transaction.rxLength = dataLength;
+	uint8_t errorcode = i2c_submitTransaction(&transaction);
+	if(errorcode){
+		return errorcode;
+	}
+	return i2c_waitForTransaction(&transaction);
+}
+
+uint8_t i2c_submitTransaction(I2C_Transaction* transaction){
+	if(i2cRegisters == 0 || transaction == 0){
+		return I2C_CODES_INVALID_PARAMS;
+	}
+	if(transaction->state == I2C_TRANSACTION_STATE_QUEUED || transaction->state == I2C_TRANSACTION_STATE_ACTIVE){
+		return I2C_CODES_INVALID_PARAMS;
+	}
+	if((transaction->txLength && transaction->txBuffer == 0) || (transaction->rxLength && transaction->rxBuffer == 0)){
+		return I2C_CODES_INVALID_PARAMS;
+	}
+	transaction->next = 0;
+	transaction->errorcode = I2C_CODES_NO_ERROR;
+	transaction->state = I2C_TRANSACTION_STATE_QUEUED;
+
+	char cSREG = SREG;
+	cli();
+	if(i2cQueueTail){
+		i2cQueueTail->next = transaction;
+		i2cQueueTail = transaction;
+	}
+	else{
+		i2cQueueHead = transaction;
+		i2cQueueTail = transaction;
+		i2cInternal_startTransaction(transaction);
+	}
+	SREG = cSREG;
+	return I2C_CODES_NO_ERROR;
+}
+
+uint8_t i2c_isTransactionDone(I2C_Transaction* transaction){
+	return transaction->state == I2C_TRANSACTION_STATE_DONE;
+}
+
+uint8_t i2c_waitForTransaction(I2C_Transaction* transaction){
+	if(transaction->state == I2C_TRANSACTION_STATE_IDLE){
+		return I2C_CODES_INVALID_PARAMS;
+	}
+	PROFILE_BEGIN(PROFILE_I2C_WAIT);
+	while(transaction->state != I2C_TRANSACTION_STATE_DONE){
+		if(delayAbstraction_prepareSleep()){
+			//the TWI interrupt of the next bus step wakes the core, the progress deadline bounds the sleep
+			if(transaction->state != I2C_TRANSACTION_STATE_DONE){
+				delayAbstraction_sleepUntilInterrupt(delayAbstraction_remainingMicros(&i2cProgressTimeout));
+			}
+			else{
+				sei();
+			}
+		}
+		//with global interrupts disabled the state machine is driven by polling TWINT
+		else if(abstraction_isBitSet(I2C_REGISTER_CONTROL, I2C_BIT_INT)){
+			i2cInternal_serviceInterrupt();
+		}
+		//a slave holding SDA low or an unplugged device must not stall the caller
+		i2c_checkTimeout();
+	}
+	PROFILE_END(PROFILE_I2C_WAIT);
+	return transaction->errorcode;
+}
+
+uint8_t i2c_isIdle(void){
+	return i2cQueueHead == 0;
+}
+
+void i2c_setTimeout(uint32_t timeoutMicros){
+	i2cTimeoutMicros = timeoutMicros;
+}
+
+void i2c_checkTimeout(void){
+	char cSREG = SREG;
+	cli();
+	I2C_Transaction* transaction = i2cQueueHead;
+	if(transaction && transaction->state == I2C_TRANSACTION_STATE_ACTIVE && delayAbstraction_hasExpired(&i2cProgressTimeout)){
+		i2cInternal_recoverBus();
+		i2cInternal_completeTransaction(transaction, I2C_CODES_TIMEOUT);
+	}
+	SREG = cSREG;
+}
+
+uint16_t i2c_getErrorCount(uint8_t errorcode){
+	if(errorcode >= I2C_CODES_COUNT){
+		return 0;
+	}
+	char cSREG = SREG;
+	cli();
+	uint16_t count = i2cErrorCounts[errorcode];
+	SREG = cSREG;
+	return count;
+}
+
+void i2c_resetErrorCounts(void){
+	char cSREG = SREG;
+	cli();
+	for (uint8_t i = 0; i < I2C_CODES_COUNT; ++i){
+		i2cErrorCounts[i] = 0;
+	}
+	SREG = cSREG;
+}
+
+ISR(TWI_vect){
+	i2cInternal_serviceInterrupt();
+}
+
+//##################################
+//Internal applications
+uint8_t i2cInternal_runBlocking(uint8_t flags, uint8_t* txBuffer, uint16_t txLength, uint8_t* rxBuffer, uint16_t rxLength){
+	I2C_Transaction transaction = {0};
+	transaction.slaveAddress = i2cSlaveAddress;
+	transaction.clockSetting = i2cSlaveClockSetting;
+	transaction.flags = flags;
+	transaction.txBuffer = txBuffer;
+	transaction.txLength = txLength;
+	transaction.rxBuffer = rxBuffer;
+	transaction.rxLength = rxLength;
+	uint8_t errorcode = i2c_submitTransaction(&transaction);
+	if(errorcode){
+		return errorcode;
+	}
+	return i2c_waitForTransaction(&transaction);
+}
+
+uint16_t i2cInternal_getWriteLength(I2C_Transaction* transaction){
+	if(transaction->flags & I2C_TRANSACTION_FLAG_REGISTER){
+		return transaction->txLength + 1;
+	}
+	return transaction->txLength;
+}
+
+void i2cInternal_startTransaction(I2C_Transaction* transaction){
+	transaction->state = I2C_TRANSACTION_STATE_ACTIVE;
+	i2cWriteIndex = 0;
+	i2cReadIndex = 0;
+	i2cReadPhase = 0;
+	delayAbstraction_startTimeout(&i2cProgressTimeout, i2cTimeoutMicros);
+#ifdef I2C_TRACE
+	i2cTraceStartMicros = i2cProgressTimeout.start;
+	i2cTraceLastStatus = I2C_TRACE_STATUS_NONE;
+#endif
+
+	if(transaction->flags & I2C_TRANSACTION_FLAG_NO_START){
+		if(!i2cBusHeld){
+			//nothing to continue on, e.g. the START of this transfer already failed and released the bus
+			i2cInternal_completeTransaction(transaction, I2C_CODES_START_CONDITION_FAILED);
+			return;
+		}
+		i2cInternal_continueWrite(transaction);
+		return;
+	}
+
+	i2cReadPhase = (i2cInternal_getWriteLength(transaction) == 0 && transaction->rxLength > 0);
+	//a STOP issued by the previous transaction has to be on the bus before the next START
+	while(abstraction_isBitSet(I2C_REGISTER_CONTROL, I2C_BIT_STOP)){
+		if(delayAbstraction_hasExpired(&i2cProgressTimeout)){
+			i2cInternal_recoverBus();
+			delayAbstraction_startTimeout(&i2cProgressTimeout, i2cTimeoutMicros);
+			break;
+		}
+	}
+	//every device runs at its own speed, the clock is switched while the bus is free
+	I2C_ClockSetting* clockSetting = transaction->clockSetting ? transaction->clockSetting : &i2cDefaultClockSetting;
+	abstraction_setRegisterToValue(I2C_REGISTER_BAUDRATE, clockSetting->bitRate);
+	abstraction_setRegisterToValue(I2C_REGISTER_STATUS, clockSetting->prescalerBits);
+	abstraction_setRegisterToValue(I2C_REGISTER_CONTROL, I2C_CONTROL_CONTINUE | (1 << I2C_BIT_START));
+}
+
+void i2cInternal_continueWrite(I2C_Transaction* transaction){
+	if(i2cWriteIndex < i2cInternal_getWriteLength(transaction)){
+		uint8_t data;
+		if(transaction->flags & I2C_TRANSACTION_FLAG_REGISTER){
+			data = i2cWriteIndex ? transaction->txBuffer[i2cWriteIndex - 1] : transaction->registerAddress;
+		}
+		else{
+			data = transaction->txBuffer[i2cWriteIndex];
+		}
+		i2cWriteIndex++;
+		abstraction_setRegisterToValue(I2C_REGISTER_DATA, data);
+		abstraction_setRegisterToValue(I2C_REGISTER_CONTROL, I2C_CONTROL_CONTINUE);
+	}
+	else if(transaction->rxLength > 0){
+		i2cReadPhase = 1;
+		abstraction_setRegisterToValue(I2C_REGISTER_CONTROL, I2C_CONTROL_CONTINUE | (1 << I2C_BIT_START));
+	}
+	else{
+		i2cInternal_finishTransaction(transaction, I2C_CODES_NO_ERROR);
+	}
+}
+
+void i2cInternal_continueRead(I2C_Transaction* transaction){
+	//acknowledge every byte but the last one
+	if(transaction->rxLength - i2cReadIndex > 1){
+		abstraction_setRegisterToValue(I2C_REGISTER_CONTROL, I2C_CONTROL_CONTINUE | (1 << I2C_BIT_ENABLE_ACK));
+	}
+	else{
+		abstraction_setRegisterToValue(I2C_REGISTER_CONTROL, I2C_CONTROL_CONTINUE);
+	}
+}
+
+void i2cInternal_serviceInterrupt(void){
+	I2C_Transaction* transaction = i2cQueueHead;
+	if(transaction == 0){
+		abstraction_setRegisterBitsLow(I2C_REGISTER_CONTROL, (1 << I2C_BIT_INTERRUPT_ENABLE) | (1 << I2C_BIT_INT));
+		return;
+	}
+
+	uint8_t status = abstraction_getRegisterValue(I2C_REGISTER_STATUS) & I2C_STATUS_MASK;
+#ifdef I2C_TRACE
+	i2cTraceLastStatus = status;
+#endif
+	delayAbstraction_startTimeout(&i2cProgressTimeout, i2cTimeoutMicros);
+	switch(status){
+		case I2C_STATUS_START:
+		case I2C_STATUS_REPEATED_START:
+			abstraction_setRegisterToValue(I2C_REGISTER_DATA, (transaction->slaveAddress << 1) | (i2cReadPhase ? I2C_BIT_READ : I2C_BIT_WRITE));
+			abstraction_setRegisterToValue(I2C_REGISTER_CONTROL, I2C_CONTROL_CONTINUE);
+			break;
+		case I2C_STATUS_SLAVE_WRITE_ACK_RECEIVED:
+		case I2C_STATUS_DATA_TRANSMIT_ACK_RECEIVED:
+			i2cInternal_continueWrite(transaction);
+			break;
+		case I2C_STATUS_SLAVE_READ_ACK_RECEIVED:
+			i2cInternal_continueRead(transaction);
+			break;
+		case I2C_STATUS_DATA_READ_ACK_SENT:
+			transaction->rxBuffer[i2cReadIndex++] = abstraction_getRegisterValue(I2C_REGISTER_DATA);
+			i2cInternal_continueRead(transaction);
+			break;
+		case I2C_STATUS_DATA_READ_NACK_SENT:
+			transaction->rxBuffer[i2cReadIndex++] = abstraction_getRegisterValue(I2C_REGISTER_DATA);
+			i2cInternal_finishTransaction(transaction, I2C_CODES_NO_ERROR);
+			break;
+		case I2C_STATUS_SLAVE_WRITE_NACK_RECEIVED:
+		case I2C_STATUS_SLAVE_READ_NACK_RECEIVED:
+			i2cInternal_finishTransaction(transaction, I2C_CODES_SLAVE_ADDR_TRANSMIT_FAILED);
+			break;
+		case I2C_STATUS_DATA_TRANSMIT_NACK_RECEIVED:
+			i2cInternal_finishTransaction(transaction, I2C_CODES_DATA_TRANSMIT_FAILED);
+			break;
+		default:
+			//arbitration lost, bus error or a START that did not make it onto the bus
+			i2cInternal_finishTransaction(transaction, I2C_CODES_START_CONDITION_FAILED);
+			break;
+	}
+}
+
+void i2cInternal_finishTransaction(I2C_Transaction* transaction, uint8_t errorcode){
+	if(errorcode || !(transaction->flags & I2C_TRANSACTION_FLAG_NO_STOP)){
+		abstraction_setRegisterToValue(I2C_REGISTER_CONTROL, (1 << I2C_BIT_INT) | (1 << I2C_BIT_STOP) | (1 << I2C_BIT_ENABLE));
+		i2cBusHeld = 0;
+	}
+	else{
+		//keep the bus: TWINT stays set and the interrupt is disabled until the continuing transaction is started
+		abstraction_setRegisterToValue(I2C_REGISTER_CONTROL, (1 << I2C_BIT_ENABLE));
+		i2cBusHeld = 1;
+	}
+	i2cInternal_completeTransaction(transaction, errorcode);
+}
+
+void i2cInternal_completeTransaction(I2C_Transaction* transaction, uint8_t errorcode){
+	//the indices still count the bytes of this transaction, the next one resets them
+	I2C_TRACE_RECORD(transaction->slaveAddress, i2cWriteIndex + i2cReadIndex, i2cTraceLastStatus, errorcode, i2cTraceStartMicros);
+	i2cInternal_countError(errorcode);
+	transaction->errorcode = errorcode;
+	transaction->state = I2C_TRANSACTION_STATE_DONE;
+	i2cQueueHead = transaction->next;
+	if(i2cQueueHead == 0){
+		i2cQueueTail = 0;
+	}
+	else{
+		i2cInternal_startTransaction(i2cQueueHead);
+	}
+	//the callback may submit follow-up transactions, the queue is consistent at this point
+	if(transaction->callback){
+		transaction->callback(transaction);
+	}
+}
+
+void i2cInternal_countError(uint8_t errorcode){
+	if(errorcode == I2C_CODES_NO_ERROR || errorcode >= I2C_CODES_COUNT){
+		return;
+	}
+	if(i2cErrorCounts[errorcode] != 0xFFFF){
+		i2cErrorCounts[errorcode]++;
+	}
+}
+
+//The port drives a line low by clearing the pull-up before the pin becomes an output, never high
+void i2cInternal_pullLineLow(uint8_t pin){
+	abstraction_setRegisterBitsLow(I2C_REGISTER_PULLUP_PORT, (1 << pin));
+	abstraction_setRegisterBitsHigh(I2C_REGISTER_PULLUP_DIRECTION, (1 << pin));
+	delayAbstraction_delayMicroseconds(I2C_RECOVERY_HALF_PERIOD_US);
+}
+
+void i2cInternal_releaseLine(uint8_t pin){
+	abstraction_setRegisterBitsLow(I2C_REGISTER_PULLUP_DIRECTION, (1 << pin));
+	abstraction_setRegisterBitsHigh(I2C_REGISTER_PULLUP_PORT, (1 << pin));
+	delayAbstraction_delayMicroseconds(I2C_RECOVERY_HALF_PERIOD_US);
+}
+
+/*
+	A slave that lost clocks in the middle of a byte keeps SDA low until it has shifted out its remaining bits.
+	With the TWI disabled the pins belong to the port again: nine clock pulses finish any byte including its
+	acknowledge, a STOP (SDA rising while SCL is high) resets the slaves, then the TWI is set up like in i2c_init.
+*/
+void i2cInternal_recoverBus(void){
+	abstraction_setRegisterToValue(I2C_REGISTER_CONTROL, 0);
+	i2cInternal_releaseLine(I2C_PIN_SDA);
+	i2cInternal_releaseLine(I2C_PIN_SCL);
+	for (uint8_t i = 0; i < I2C_RECOVERY_CLOCK_PULSES; ++i){
+		i2cInternal_pullLineLow(I2C_PIN_SCL);
+		i2cInternal_releaseLine(I2C_PIN_SCL);
+	}
+	i2cInternal_pullLineLow(I2C_PIN_SCL);
+	i2cInternal_pullLineLow(I2C_PIN_SDA);
+	i2cInternal_releaseLine(I2C_PIN_SCL);
+	i2cInternal_releaseLine(I2C_PIN_SDA);
+
+	i2cBusHeld = 0;
+	abstraction_setRegisterToValue(I2C_REGISTER_STATUS, i2cDefaultClockSetting.prescalerBits);
+	abstraction_setRegisterToValue(I2C_REGISTER_BAUDRATE, i2cDefaultClockSetting.bitRate);
+	abstraction_setRegisterToValue(I2C_REGISTER_CONTROL, (1 << I2C_BIT_ENABLE));
+}
+
+#endif // TEST
@@ -14,6 +14,17 @@ typedef struct{
 	volatile uint8_t sclPin;
 }I2C_Registers;
 
+/*
+	TWBR and TWPS for one bus speed: SCL = F_CPU / (16 + 2 * bitRate * 4^prescalerBits).
+	Computed once with i2c_computeClockSetting, then handed to transactions of devices that run at their own speed.
+*/
+typedef struct{
+	uint8_t bitRate;
+	uint8_t prescalerBits;
+}I2C_ClockSetting;
+
+#define I2C_MAX_CLOCKSPEED 400000L
+
 #define I2C_FUNCTIONCODES_NO_ERROR 0
 #define I2C_FUNCTIONCODES_INVALID_PARAMS 1
 
@@ -23,10 +34,64 @@ typedef struct{
 #define I2C_CODES_SLAVE_ADDR_TRANSMIT_FAILED 3
 #define I2C_CODES_DATA_TRANSMIT_FAILED 4
 #define I2C_CODES_DATA_READ_FAILED 5
+#define I2C_CODES_TIMEOUT 6 //no bus progress within the timeout, the bus was recovered
+#define I2C_CODES_COUNT 7
+
+//Longest time one step on the bus (START, a byte, STOP) may take before the transfer is aborted.
+//A byte takes 90us at 100kHz and 0.9ms at 10kHz, raise it for slower buses or slaves that stretch the clock.
+#ifndef I2C_DEFAULT_TIMEOUT_US
+#define I2C_DEFAULT_TIMEOUT_US 2000UL
+#endif
+#define I2C_RECOVERY_CLOCK_PULSES 9
+#define I2C_RECOVERY_HALF_PERIOD_US 5
+
+//Transaction flags
+#define I2C_TRANSACTION_FLAG_NO_START 0x01 //continue on the bus left open by the previous transaction
+#define I2C_TRANSACTION_FLAG_NO_STOP 0x02 //leave the bus open for a following NO_START transaction
+#define I2C_TRANSACTION_FLAG_REGISTER 0x04 //send registerAddress before the tx buffer
 
+#define I2C_TRANSACTION_STATE_IDLE 0
+#define I2C_TRANSACTION_STATE_QUEUED 1
+#define I2C_TRANSACTION_STATE_ACTIVE 2
+#define I2C_TRANSACTION_STATE_DONE 3
 
+typedef struct I2C_Transaction I2C_Transaction;
+typedef void (*I2C_TransactionCallback)(I2C_Transaction* transaction);
+
+/*
+	Descriptor of one asynchronous transfer:
+	START, SLA+W, [registerAddress], tx bytes, then if rxLength > 0 a repeated START, SLA+R, rx bytes, STOP.
+	The descriptor and its buffers must stay valid until the state is I2C_TRANSACTION_STATE_DONE.
+	The callback runs from the TWI interrupt, keep it short.
+*/
+struct I2C_Transaction{
+	uint8_t slaveAddress;
+	uint8_t flags;
+	I2C_ClockSetting* clockSetting; //0 runs the transfer at the clock given to i2c_init
+	uint8_t registerAddress;
+	uint8_t* txBuffer;
+	uint16_t txLength;
+	uint8_t* rxBuffer;
+	uint16_t rxLength;
+	I2C_TransactionCallback callback;
+	void* userData;
+	volatile uint8_t state;
+	volatile uint8_t errorcode;
+	I2C_Transaction* next;
+};
+
+/*
+	Sets up the TWI, the clockspeed is the default of transactions without a clock setting. Every driver of a
+	device on the bus may call it: once the bus runs with these registers, later calls return without touching
+	it, so transfers that are queued or on the bus are kept and the first clockspeed stays the default.
+*/
 uint8_t i2c_init(I2C_Registers* i2cRegisters, uint32_t clockspeed);
+uint32_t i2c_getClockspeed(void);
+//Rounds down to the closest rate the TWI can make, never runs the bus faster than requested
+uint8_t i2c_computeClockSetting(uint32_t clockspeed, I2C_ClockSetting* setting, uint32_t* actualClockspeed);
 void i2c_setSlaveAddress(uint8_t addressToSet);
+//Clock for the following START of the piecewise functions below, 0 goes back to the clock given to i2c_init
+void i2c_setSlaveClockSetting(I2C_ClockSetting* setting);
 uint8_t i2c_sendStartCondition(void);
 void i2c_sendStopCondition(void);
 uint8_t i2c_write(uint8_t data);
@@ -37,4 +102,22 @@ uint8_t i2c_read();
 int8_t i2c_writeToRegister(uint8_t deviceAddress, uint8_t registerAddress, uint8_t *data, uint16_t dataLength);
 int8_t i2c_readFromRegister(uint8_t deviceAddress, uint8_t registerAddress, uint8_t* dataBuffer, uint16_t dataLength);
 
+//Asynchronous interface, the blocking functions above are wrappers around it
+uint8_t i2c_submitTransaction(I2C_Transaction* transaction);
+uint8_t i2c_isTransactionDone(I2C_Transaction* transaction);
+uint8_t i2c_waitForTransaction(I2C_Transaction* transaction);
+uint8_t i2c_isIdle(void);
+
+/*
+	Bounded latency. Every transfer, blocking or not, is aborted with I2C_CODES_TIMEOUT when the bus makes no
+	progress for the timeout. The bus is then recovered: nine SCL pulses let a slave that holds SDA low finish
+	its byte, a STOP resets the slaves and the TWI is set up again. Blocking functions check the timeout while
+	they wait, code that only submits transactions calls i2c_checkTimeout, e.g. from a periodic task.
+*/
+void i2c_setTimeout(uint32_t timeoutMicros);
+void i2c_checkTimeout(void);
+//Failed transfers per I2C_CODES_* value, counted up to 65535
+uint16_t i2c_getErrorCount(uint8_t errorcode);
+void i2c_resetErrorCounts(void);
+
 #endif // _I2CINTERFACE_H
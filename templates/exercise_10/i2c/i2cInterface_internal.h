@@ -2,6 +2,7 @@
 #define _I2C_INTERFACE_INTERNAL_H_
 
 #include <stdint.h>
+#include "i2cInterface.h"
 
 #ifndef F_CPU
 #define F_CPU 16000000L
@@ -15,6 +16,9 @@
 #define I2C_BIT_ENABLE_ACK 6
 #define I2C_BIT_INT 7
 #define I2C_BIT_REPEATED_START 0x10
+#define I2C_BIT_INTERRUPT_ENABLE 0
+
+#define I2C_STATUS_MASK 0xF8
 
 #define I2C_STATUS_START 0x08
 #define I2C_STATUS_REPEATED_START 0x10
@@ -23,6 +27,25 @@
 #define I2C_STATUS_DATA_TRANSMIT_ACK_RECEIVED 0x28
 #define I2C_STATUS_DATA_READ_ACK_SENT 0x50
 #define I2C_STATUS_DATA_READ_NACK_SENT 0x58
+#define I2C_STATUS_SLAVE_WRITE_NACK_RECEIVED 0x20
+#define I2C_STATUS_DATA_TRANSMIT_NACK_RECEIVED 0x30
+#define I2C_STATUS_ARBITRATION_LOST 0x38
+#define I2C_STATUS_SLAVE_READ_NACK_RECEIVED 0x48
+#define I2C_STATUS_BUS_ERROR 0x00
+
+void i2cInternal_serviceInterrupt(void);
+void i2cInternal_startTransaction(I2C_Transaction* transaction);
+void i2cInternal_continueWrite(I2C_Transaction* transaction);
+void i2cInternal_continueRead(I2C_Transaction* transaction);
+void i2cInternal_finishTransaction(I2C_Transaction* transaction, uint8_t errorcode);
+void i2cInternal_completeTransaction(I2C_Transaction* transaction, uint8_t errorcode);
+uint16_t i2cInternal_getWriteLength(I2C_Transaction* transaction);
+uint32_t i2cInternal_getClockRate(I2C_ClockSetting* setting);
+void i2cInternal_pullLineLow(uint8_t pin);
+void i2cInternal_releaseLine(uint8_t pin);
+void i2cInternal_recoverBus(void);
+void i2cInternal_countError(uint8_t errorcode);
+uint8_t i2cInternal_runBlocking(uint8_t flags, uint8_t* txBuffer, uint16_t txLength, uint8_t* rxBuffer, uint16_t rxLength);
 
 
 
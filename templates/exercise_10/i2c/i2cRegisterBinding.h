@@ -0,0 +1,67 @@
+#ifndef _I2C_REGISTERBINDING_H_
+#define _I2C_REGISTERBINDING_H_
+
+#include <stdint.h>
+#include "i2cInterface.h"
+
+/*
+	TWI registers and bus pins of the target, used for the I2C_Registers given to i2c_init.
+	The pins are PC4 (SDA) and PC5 (SCL) on the ATmega328P, define them before this header for other parts.
+*/
+#ifndef TEST
+#include <avr/io.h>
+
+#ifndef I2C_BAUDRATEREGISTER
+#define I2C_BAUDRATEREGISTER TWBR
+#define I2C_STATUSREGISTER TWSR
+#define I2C_CONTROLREGISTER TWCR
+#define I2C_DATAREGISTER TWDR
+#define I2C_PULLUPPINS_DIRECTIONREGISTER DDRC
+#define I2C_PULLUPPINS_PORTREGISTER PORTC
+#define I2C_SDA_PIN PC4
+#define I2C_SCL_PIN PC5
+#endif
+
+#define I2C_REGISTERS_INITIALISER { \
+	&I2C_BAUDRATEREGISTER, \
+	&I2C_STATUSREGISTER, \
+	&I2C_CONTROLREGISTER, \
+	&I2C_DATAREGISTER, \
+	&I2C_PULLUPPINS_DIRECTIONREGISTER, \
+	&I2C_PULLUPPINS_PORTREGISTER, \
+	I2C_SDA_PIN, \
+	I2C_SCL_PIN \
+}
+#endif // TEST
+
+/*
+	How i2cInterface.c reaches the registers.
+	With REGISTERABSTRACTION_STATIC_BINDING they are the constant addresses above and the inline accessors of
+	registerAbstraction.h become single I/O instructions. I2C_Registers is then only checked for being set.
+	Without it every access goes through the pointers of the I2C_Registers given to i2c_init, so a test build
+	can point them at plain variables.
+*/
+#ifdef REGISTERABSTRACTION_STATIC_BINDING
+#ifdef TEST
+#error "REGISTERABSTRACTION_STATIC_BINDING needs the registers of the target"
+#endif
+#define I2C_REGISTER_BAUDRATE (&I2C_BAUDRATEREGISTER)
+#define I2C_REGISTER_STATUS (&I2C_STATUSREGISTER)
+#define I2C_REGISTER_CONTROL (&I2C_CONTROLREGISTER)
+#define I2C_REGISTER_DATA (&I2C_DATAREGISTER)
+#define I2C_REGISTER_PULLUP_DIRECTION (&I2C_PULLUPPINS_DIRECTIONREGISTER)
+#define I2C_REGISTER_PULLUP_PORT (&I2C_PULLUPPINS_PORTREGISTER)
+#define I2C_PIN_SDA I2C_SDA_PIN
+#define I2C_PIN_SCL I2C_SCL_PIN
+#else
+#define I2C_REGISTER_BAUDRATE (i2cRegisters->baudrateRegister)
+#define I2C_REGISTER_STATUS (i2cRegisters->statusRegister)
+#define I2C_REGISTER_CONTROL (i2cRegisters->controlRegister)
+#define I2C_REGISTER_DATA (i2cRegisters->dataRegister)
+#define I2C_REGISTER_PULLUP_DIRECTION (i2cRegisters->pullUpPinsDataDirectionRegister)
+#define I2C_REGISTER_PULLUP_PORT (i2cRegisters->pullUpPinsPortRegister)
+#define I2C_PIN_SDA (i2cRegisters->sdaPin)
+#define I2C_PIN_SCL (i2cRegisters->sclPin)
+#endif // REGISTERABSTRACTION_STATIC_BINDING
+
+#endif /* _I2C_REGISTERBINDING_H_ */
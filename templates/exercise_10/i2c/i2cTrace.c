@@ -0,0 +1,118 @@
+#ifdef I2C_TRACE
+
+#include "i2cTrace.h"
+
+#include <stdlib.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "delayAbstraction.h"
+#include "memoryAbstraction.h"
+
+#define I2C_TRACE_SIGNATURE 0x7A3C
+#define I2C_TRACE_MAX_NUMBER_LENGTH 11
+
+typedef struct{
+	uint16_t signature;
+	uint8_t head; //next entry to write
+	uint8_t length;
+	I2C_TraceEntry entries[I2C_TRACE_SIZE];
+}I2C_TraceRing;
+
+I2C_TraceRing i2cTraceRing MEMORYABSTRACTION_NOINIT;
+uint8_t i2cTraceInitialised = 0;
+
+void i2cTrace_initialise(void){
+	if(i2cTraceInitialised){
+		return;
+	}
+	i2cTraceInitialised = 1;
+	//after a power loss the RAM holds noise, the signature and the indices tell it apart from a trace
+	if(i2cTraceRing.signature != I2C_TRACE_SIGNATURE || i2cTraceRing.head >= I2C_TRACE_SIZE || i2cTraceRing.length > I2C_TRACE_SIZE){
+		i2cTrace_clear();
+		return;
+	}
+	i2cTrace_record(I2C_TRACE_ADDRESS_RESET, 0, I2C_TRACE_STATUS_NONE, 0, delayAbstraction_nowMicros());
+}
+
+//Called from completeTransaction with interrupts disabled
+void i2cTrace_record(uint8_t address, uint16_t length, uint8_t status, uint8_t errorcode, uint32_t startMicros){
+	I2C_TraceEntry* entry = &i2cTraceRing.entries[i2cTraceRing.head];
+	uint32_t duration = delayAbstraction_nowMicros() - startMicros;
+	entry->startMicros = startMicros;
+	entry->durationMicros = duration > 0xFFFF ? 0xFFFF : (uint16_t)duration;
+	entry->length = length;
+	entry->address = address;
+	entry->status = status;
+	entry->errorcode = errorcode;
+	i2cTraceRing.head = (i2cTraceRing.head + 1) & (I2C_TRACE_SIZE - 1);
+	if(i2cTraceRing.length < I2C_TRACE_SIZE){
+		i2cTraceRing.length++;
+	}
+}
+
+uint8_t i2cTrace_getLength(void){
+	return i2cTraceRing.length;
+}
+
+uint8_t i2cTrace_getEntry(uint8_t index, I2C_TraceEntry* entry){
+	char cSREG = SREG;
+	cli();
+	uint8_t found = index < i2cTraceRing.length;
+	if(found){
+		*entry = i2cTraceRing.entries[(uint8_t)(i2cTraceRing.head - i2cTraceRing.length + index) & (I2C_TRACE_SIZE - 1)];
+	}
+	SREG = cSREG;
+	return found;
+}
+
+void i2cTrace_clear(void){
+	char cSREG = SREG;
+	cli();
+	i2cTraceRing.signature = I2C_TRACE_SIGNATURE;
+	i2cTraceRing.head = 0;
+	i2cTraceRing.length = 0;
+	SREG = cSREG;
+}
+
+void i2cTraceInternal_putFlashString(I2C_TracePutChar putChar, const char* string){
+	char c;
+	while((c = memoryAbstraction_readFlashByte(string++))){
+		putChar(c);
+	}
+}
+
+void i2cTraceInternal_putNumber(I2C_TracePutChar putChar, uint32_t value, uint8_t radix){
+	char digits[I2C_TRACE_MAX_NUMBER_LENGTH];
+	ultoa(value, digits, radix);
+	putChar(' ');
+	for (char* c = digits; *c; ++c){
+		putChar(*c);
+	}
+}
+
+void i2cTrace_dump(I2C_TracePutChar putChar, uint8_t clearAfterDump){
+	//the entries are copied out one by one, transfers finishing meanwhile may push the oldest ones out
+	uint8_t length = i2cTrace_getLength();
+	i2cTraceInternal_putFlashString(putChar, MEMORYABSTRACTION_FLASH_STRING("I2CT BEGIN"));
+	i2cTraceInternal_putNumber(putChar, length, 10);
+	i2cTraceInternal_putNumber(putChar, delayAbstraction_nowMicros(), 10);
+	putChar('\n');
+	I2C_TraceEntry entry;
+	for (uint8_t i = 0; i < length && i2cTrace_getEntry(i, &entry); ++i){
+		i2cTraceInternal_putFlashString(putChar, MEMORYABSTRACTION_FLASH_STRING("I2CT"));
+		i2cTraceInternal_putNumber(putChar, entry.startMicros, 10);
+		i2cTraceInternal_putNumber(putChar, entry.durationMicros, 10);
+		i2cTraceInternal_putNumber(putChar, entry.address, 16);
+		i2cTraceInternal_putNumber(putChar, entry.length, 10);
+		i2cTraceInternal_putNumber(putChar, entry.status, 16);
+		i2cTraceInternal_putNumber(putChar, entry.errorcode, 10);
+		putChar('\n');
+	}
+	i2cTraceInternal_putFlashString(putChar, MEMORYABSTRACTION_FLASH_STRING("I2CT END\n"));
+	if(clearAfterDump){
+		i2cTrace_clear();
+	}
+}
+
+#endif // I2C_TRACE
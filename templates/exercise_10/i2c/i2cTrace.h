@@ -0,0 +1,72 @@
+#ifndef _I2C_TRACE_H_
+#define _I2C_TRACE_H_
+
+#include <stdint.h>
+
+/*
+	Post-mortem trace of the bus. Every finished transaction leaves one entry in a RAM ring, the oldest entry is
+	overwritten when it is full. The ring is in MEMORYABSTRACTION_NOINIT memory: after a watchdog or external
+	reset it still holds the transfers that led up to it, marked off from the new ones by a reset entry.
+	Recording takes one read of the time base and a few stores in completeTransaction.
+
+	Enabled with I2C_TRACE=1 in the Makefile (-DI2C_TRACE), otherwise the hooks compile to nothing.
+*/
+
+//Entries in the ring, a power of two
+#ifndef I2C_TRACE_SIZE
+#define I2C_TRACE_SIZE 16
+#endif
+
+//Address of the entry written by the first i2c_init after a reset, 7 bit addresses end at 0x7F
+#define I2C_TRACE_ADDRESS_RESET 0xFF
+//Status of a transfer the TWI never reported on, the value TWSR reads while no step is pending
+#define I2C_TRACE_STATUS_NONE 0xF8
+
+typedef struct{
+	uint32_t startMicros;
+	uint16_t durationMicros; //stops at 65535
+	uint16_t length; //bytes on the bus after the address byte, the register address included
+	uint8_t address;
+	uint8_t status; //last I2C_STATUS_* value of the transfer
+	uint8_t errorcode; //I2C_CODES_* value the transfer finished with
+}I2C_TraceEntry;
+
+typedef void (*I2C_TracePutChar)(char c);
+
+#ifdef I2C_TRACE
+
+#ifdef TEST
+#error "I2C_TRACE records the transactions of the target driver"
+#endif
+
+#if (I2C_TRACE_SIZE & (I2C_TRACE_SIZE - 1)) || I2C_TRACE_SIZE > 128
+#error "I2C_TRACE_SIZE has to be a power of two up to 128"
+#endif
+
+#define I2C_TRACE_INITIALISE() i2cTrace_initialise()
+#define I2C_TRACE_RECORD(address, length, status, errorcode, startMicros) i2cTrace_record(address, length, status, errorcode, startMicros)
+
+//Keeps the entries from before the reset when the ring is intact, clears it otherwise. Only the first call after a reset does anything
+void i2cTrace_initialise(void);
+void i2cTrace_record(uint8_t address, uint16_t length, uint8_t status, uint8_t errorcode, uint32_t startMicros);
+uint8_t i2cTrace_getLength(void);
+//index 0 is the oldest entry, returns 0 past the end
+uint8_t i2cTrace_getEntry(uint8_t index, I2C_TraceEntry* entry);
+void i2cTrace_clear(void);
+/*
+	Sends the ring as text lines, oldest entry first, framed like the profiler dump for serial_echo.py:
+		I2CT BEGIN <entries> <current time in us>
+		I2CT <start us> <duration us> <address> <length> <status> <errorcode>
+		I2CT END
+	Address and status are in hex. clearAfterDump starts an empty trace.
+*/
+void i2cTrace_dump(I2C_TracePutChar putChar, uint8_t clearAfterDump);
+
+#else
+
+#define I2C_TRACE_INITIALISE()
+#define I2C_TRACE_RECORD(address, length, status, errorcode, startMicros)
+
+#endif // I2C_TRACE
+
+#endif // _I2C_TRACE_H_
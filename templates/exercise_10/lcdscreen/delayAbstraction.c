@@ -1,14 +1,98 @@
 #include "delayAbstraction.h"
 #include "platformConfig.h"
+#include "profiler.h"
 
-void delayAbstraction_delayMilliseconds(uint32_t waitingPeriodInMilliseconds){
-	for (uint32_t i = 0; i < waitingPeriodInMilliseconds; ++i){
-		delayForOneMillisecond();
+uint8_t timeBaseInitialised = 0;
+uint32_t powerStatisticsStartMicros = 0;
+uint32_t powerAsleepMicros = 0;
+uint32_t powerSleeps = 0;
+
+void delayAbstraction_initialise(void){
+	timeBaseInitialise();
+	timeBaseInitialised = 1;
+}
+
+uint32_t delayAbstraction_nowMicros(void){
+	if(!timeBaseInitialised){
+		delayAbstraction_initialise();
+	}
+	return timeBaseNowMicros();
+}
+
+void delayAbstraction_startTimeout(DelayAbstraction_Timeout* timeout, uint32_t durationInMicroseconds){
+	timeout->start = delayAbstraction_nowMicros();
+	//the start may be read just before the next tick, one extra tick guarantees the full duration
+	timeout->duration = durationInMicroseconds + TIMEBASE_MICROS_PER_TICK;
+}
+
+uint8_t delayAbstraction_hasExpired(DelayAbstraction_Timeout* timeout){
+	return (delayAbstraction_nowMicros() - timeout->start) >= timeout->duration;
+}
+
+uint32_t delayAbstraction_remainingMicros(DelayAbstraction_Timeout* timeout){
+	uint32_t elapsed = delayAbstraction_nowMicros() - timeout->start;
+	if(elapsed >= timeout->duration){
+		return 0;
+	}
+	return timeout->duration - elapsed;
+}
+
+void delayAbstraction_waitForTimeout(DelayAbstraction_Timeout* timeout){
+	uint32_t remaining;
+	while((remaining = delayAbstraction_remainingMicros(timeout))){
+		if(delayAbstraction_prepareSleep()){
+			delayAbstraction_sleepUntilInterrupt(remaining);
+		}
 	}
 }
 
+void delayAbstraction_delayMilliseconds(uint32_t waitingPeriodInMilliseconds){
+	PROFILE_BEGIN(PROFILE_DELAY_MILLISECONDS);
+	DelayAbstraction_Timeout timeout;
+	delayAbstraction_startTimeout(&timeout, waitingPeriodInMilliseconds * 1000UL);
+	delayAbstraction_waitForTimeout(&timeout);
+	PROFILE_END(PROFILE_DELAY_MILLISECONDS);
+}
+
 void delayAbstraction_delayMicroseconds(uint32_t waitingPeriodInMicroseconds){
-	for (uint32_t i = 0; i < waitingPeriodInMicroseconds; ++i){
-		delayForOneMicrosecond();
+	PROFILE_BEGIN(PROFILE_DELAY_MICROSECONDS);
+	if(waitingPeriodInMicroseconds < DELAYABSTRACTION_MINIMUM_TIMEOUT_US){
+		busyWaitMicroseconds(waitingPeriodInMicroseconds);
+	}
+	else{
+		DelayAbstraction_Timeout timeout;
+		delayAbstraction_startTimeout(&timeout, waitingPeriodInMicroseconds);
+		delayAbstraction_waitForTimeout(&timeout);
 	}
-}
\ No newline at end of file
+	PROFILE_END(PROFILE_DELAY_MICROSECONDS);
+}
+uint8_t delayAbstraction_prepareSleep(void){
+	if(!timeBaseInterruptsEnabled()){
+		return 0;
+	}
+	timeBaseDisableInterrupts();
+	return 1;
+}
+
+void delayAbstraction_sleepUntilInterrupt(uint32_t maxMicros){
+#ifdef POWER_BUSY_WAIT
+	timeBaseSleep(maxMicros);
+#else
+	uint32_t start = delayAbstraction_nowMicros();
+	timeBaseSleep(maxMicros);
+	powerAsleepMicros += delayAbstraction_nowMicros() - start;
+	powerSleeps++;
+#endif
+}
+
+void delayAbstraction_getPowerStatistics(DelayAbstraction_PowerStatistics* statistics){
+	statistics->asleepMicros = powerAsleepMicros;
+	statistics->awakeMicros = (delayAbstraction_nowMicros() - powerStatisticsStartMicros) - powerAsleepMicros;
+	statistics->sleeps = powerSleeps;
+}
+
+void delayAbstraction_resetPowerStatistics(void){
+	powerStatisticsStartMicros = delayAbstraction_nowMicros();
+	powerAsleepMicros = 0;
+	powerSleeps = 0;
+}
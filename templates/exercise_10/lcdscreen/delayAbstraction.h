@@ -3,6 +3,42 @@
 
 #include <stdint.h>
 
+//Shorter waits use the calibrated busy loop, they are below the resolution of the time base
+#define DELAYABSTRACTION_MINIMUM_TIMEOUT_US 20
+
+typedef struct{
+	uint32_t start;
+	uint32_t duration;
+}DelayAbstraction_Timeout;
+
+typedef struct{
+	uint32_t asleepMicros; //in IDLE sleep, including the interrupt that ended it
+	uint32_t awakeMicros;
+	uint32_t sleeps;
+}DelayAbstraction_PowerStatistics;
+
+void delayAbstraction_initialise(void);
+uint32_t delayAbstraction_nowMicros(void);
+
+//Non-blocking deadlines, safe across the wrap of the microsecond counter for durations below 35 minutes
+void delayAbstraction_startTimeout(DelayAbstraction_Timeout* timeout, uint32_t durationInMicroseconds);
+uint8_t delayAbstraction_hasExpired(DelayAbstraction_Timeout* timeout);
+uint32_t delayAbstraction_remainingMicros(DelayAbstraction_Timeout* timeout);
+void delayAbstraction_waitForTimeout(DelayAbstraction_Timeout* timeout);
+
 void delayAbstraction_delayMilliseconds(uint32_t waitingPeriodInMilliseconds);
 void delayAbstraction_delayMicroseconds(uint32_t waitingPeriodInMicroseconds);
+
+/*
+	Waits put the MCU into IDLE sleep until the next interrupt, build with POWER_BUSY_WAIT to spin instead.
+	Code that waits on something an interrupt changes calls prepareSleep, checks its condition and then calls
+	sleepUntilInterrupt, which returns with interrupts enabled after the next interrupt or maxMicros.
+	prepareSleep disables interrupts for the check. It returns 0 when they were disabled already: nothing would
+	end a sleep then, the caller polls instead.
+*/
+uint8_t delayAbstraction_prepareSleep(void);
+void delayAbstraction_sleepUntilInterrupt(uint32_t maxMicros);
+//Time since the last reset split into asleep and awake, awake time is what the core spends at full power
+void delayAbstraction_getPowerStatistics(DelayAbstraction_PowerStatistics* statistics);
+void delayAbstraction_resetPowerStatistics(void);
 #endif // _DELAYABSTRACTION_H
@@ -1,54 +1,214 @@
+#ifndef TEST
+
 #include <avr/io.h>
+#include <avr/interrupt.h>
 
 #include "i2cInterface.h"
+#include "i2cRegisterBinding.h"
 #include "lcdScreenDriver.h"
 #include "registerAbstraction.h"
 #include "delayAbstraction.h"
+#include "scheduler.h"
+#include "memoryAbstraction.h"
+#include "profiler.h"
+#include "i2cTrace.h"
+#ifdef INTEGRATION_BME680
+#include <stdlib.h>
+#include "bme680.h"
+#include "sensorPipeline.h"
+#endif
+
+I2C_Registers myI2CRegisters = I2C_REGISTERS_INITIALISER;
 
-#define I2C_BAUDRATEREGISTER TWBR
-#define I2C_STATUSREGISTER TWSR
-#define I2C_CONTROLREGISTER TWCR
-#define I2C_DATAREGISTER TWDR
-#define I2C_PULLUPPINS_DIRECTIONREGISTER DDRC
-#define I2C_PULLUPPINS_PORTREGISTER PORTC
-#define I2C_SDA_PIN PC4 
-#define I2C_SCL_PIN PC5
-
-I2C_Registers myI2CRegisters = {
-	&I2C_BAUDRATEREGISTER, 
-	&I2C_STATUSREGISTER, 
-	&I2C_CONTROLREGISTER, 
-	&I2C_DATAREGISTER,
-	&I2C_PULLUPPINS_DIRECTIONREGISTER,
-	&I2C_PULLUPPINS_PORTREGISTER,
-	I2C_SDA_PIN,
-	I2C_SCL_PIN
-};
-
-#define SCREEN_ADDRESS 0x27
+#define NUMBER_OF_SCREENS 3
 #define NUMBER_OF_COLUMNS 16
 #define NUMBER_OF_ROWS 2
 
+#define LETTER_COLUMN 15
+#define LETTER_ROW 1
+#define LCD_REFRESH_PERIOD_US 50000UL
+#define LETTER_PERIOD_US 2000000UL
+#define POWER_PERIOD_US 1000000UL
+#define POWER_ROW 1
+#define PROFILE_DUMP_PERIOD_US 10000000UL
+#define SERIAL_OUTPUT_UBRR (F_CPU / 16 / BAUD - 1)
+#define SENSOR_PERIOD_US 1000000UL
+#define SENSOR_DISPLAY_PERIOD_US 1000000UL
+#define SENSOR_LOG_PERIOD_US 250000UL
+#define SENSOR_ROW 1
+#define SENSOR_MAX_NUMBER_LENGTH 12
+
+//Three backpacks on the same bus, addresses set with the A0-A2 jumpers
+uint8_t screenAddresses[NUMBER_OF_SCREENS] = {0x27, 0x26, 0x25};
+//kept over watchdog resets so the displays can be taken over without the one second power-up sequence
+LcdScreenDriver_Context screenContexts[NUMBER_OF_SCREENS] MEMORYABSTRACTION_NOINIT;
+LcdScreenDriver_Context* screens[NUMBER_OF_SCREENS] = {&screenContexts[0], &screenContexts[1], &screenContexts[2]};
+
+char currentChar = 'A';
+
+//The displays are only touched by this task, everything else draws into the framebuffers
+void lcdRefreshTask(void* argument){
+	//a display still busy after a clear or home is served last in the pass instead of holding up the others
+	lcdScreenDriver_flushAll(screens, NUMBER_OF_SCREENS);
+}
+
+void letterTask(void* argument){
+	for (uint8_t i = 0; i < NUMBER_OF_SCREENS; ++i){
+		lcdScreenDriver_bufferSetChar(screens[i], LETTER_COLUMN, LETTER_ROW, currentChar);
+	}
+	currentChar++;
+	if(currentChar>'Z'){
+		currentChar = 'A';
+	}
+}
+
+//Share of the last period the core was awake, the rest it spent in IDLE sleep
+void powerTask(void* argument){
+	DelayAbstraction_PowerStatistics statistics;
+	delayAbstraction_getPowerStatistics(&statistics);
+	delayAbstraction_resetPowerStatistics();
+	//in milliseconds the product stays within 32 bits for periods of up to 11 hours
+	uint32_t awakeMillis = statistics.awakeMicros / 1000;
+	uint32_t totalMillis = (statistics.asleepMicros + statistics.awakeMicros) / 1000;
+	uint16_t awakePercent = totalMillis ? (uint16_t)(awakeMillis * 100 / totalMillis) : 0;
+	lcdScreenDriver_bufferPrintFormat_P(screens[NUMBER_OF_SCREENS - 1], 0, POWER_ROW, MEMORYABSTRACTION_FLASH_STRING("awake %3u%%"), awakePercent);
+}
+
+#if defined(PROFILING) || defined(I2C_TRACE) || defined(INTEGRATION_BME680)
+//The dumps and sensor lines are the only output of this example, the USART only transmits and is polled
+void serialOutput_initialise(void){
+	UBRR0H = (uint8_t)(SERIAL_OUTPUT_UBRR >> 8);
+	UBRR0L = (uint8_t)SERIAL_OUTPUT_UBRR;
+	UCSR0B = (1 << TXEN0);
+	UCSR0C = (1 << UCSZ01) | (1 << UCSZ00);
+}
+
+void serialOutput_putChar(char c){
+	if(c == '\n'){
+		serialOutput_putChar('\r');
+	}
+	while(!(UCSR0A & (1 << UDRE0)));
+	UDR0 = c;
+}
+#endif
+
+#ifdef INTEGRATION_BME680
+Bme680_Device environmentSensor;
+SensorPipeline_Cursor displayCursor;
+SensorPipeline_Cursor logCursor;
+
+//Only the newest sample is shown, the display has no use for the ones in between
+void sensorDisplayTask(void* argument){
+	SensorPipeline_Sample sample;
+	uint8_t newSample = 0;
+	while(sensorPipeline_read(&displayCursor, &sample)){
+		newSample = 1;
+	}
+	if(newSample){
+		lcdScreenDriver_bufferPrintFormat_P(screens[1], 0, SENSOR_ROW, MEMORYABSTRACTION_FLASH_STRING("%5.1dC %4luhPa"), sample.measurement.temperature / 10, sample.measurement.pressure / 100);
+	}
+}
+
+void sensorLog_putNumber(uint32_t value, uint8_t isSigned){
+	char digits[SENSOR_MAX_NUMBER_LENGTH];
+	if(isSigned){
+		ltoa((int32_t)value, digits, 10);
+	}
+	else{
+		ultoa(value, digits, 10);
+	}
+	serialOutput_putChar(' ');
+	for (char* c = digits; *c; ++c){
+		serialOutput_putChar(*c);
+	}
+}
+
+//Every sample goes out as "BME680 <sequence> <timestamp us> <0.01 degC> <Pa> <0.001 %rH> <lost>"
+void sensorLogTask(void* argument){
+	SensorPipeline_Sample sample;
+	while(sensorPipeline_read(&logCursor, &sample)){
+		const char* name = MEMORYABSTRACTION_FLASH_STRING("BME680");
+		char c;
+		while((c = memoryAbstraction_readFlashByte(name++))){
+			serialOutput_putChar(c);
+		}
+		sensorLog_putNumber(sample.sequence, 0);
+		sensorLog_putNumber(sample.timestampMicros, 0);
+		sensorLog_putNumber(sample.measurement.temperature, 1);
+		sensorLog_putNumber(sample.measurement.pressure, 0);
+		sensorLog_putNumber(sample.measurement.humidity, 0);
+		sensorLog_putNumber(logCursor.lost, 0);
+		serialOutput_putChar('\n');
+	}
+}
+#endif // INTEGRATION_BME680
+
+#ifdef PROFILING
+void profileDumpTask(void* argument){
+	profiler_dump(serialOutput_putChar, 1);
+}
+#endif // PROFILING
+
 //An integration test example of the LCD screen library.
 //The expected implementation has to work with this lcd screen library.
 
 int main(int argc, char const *argv[]){
-	lcdScreenDriver_initialise(&myI2CRegisters, SCREEN_ADDRESS, NUMBER_OF_COLUMNS, NUMBER_OF_ROWS, LCDSCREEN_TYPE_5x8DOTS);
-	lcdScreenDriver_initialiseScreenToKnownState();
-	lcdScreenDriver_setBacklightOn();
-	lcdScreenDriver_setCursorOn();
-	lcdScreenDriver_clearDisplay();
-	lcdScreenDriver_setCursorHome();
-
-	char myString[] = "Hello Embedded\nSystems!";
-	lcdScreenDriver_printString(myString);
-	delayAbstraction_delayMilliseconds(1000);
-	char currentChar = 'A';
-	while(1){
-		lcdScreenDriver_printChar(currentChar++);
-		if(currentChar>'Z'){
-			currentChar = 'A';
-		}
-		delayAbstraction_delayMilliseconds(2000);
+	//the displays share the supply of the MCU, after a power-on or brown-out reset they start from scratch too
+	uint8_t resetFlags = MCUSR;
+	uint8_t powerWasLost = resetFlags & ((1 << PORF) | (1 << BORF));
+	MCUSR = 0;
+	delayAbstraction_initialise();
+#if defined(PROFILING) || defined(I2C_TRACE) || defined(INTEGRATION_BME680)
+	serialOutput_initialise();
+#endif
+#ifdef PROFILING
+	profiler_initialise();
+#endif
+#ifdef I2C_TRACE
+	//the transfers that led up to a watchdog or reset button reset, the trace goes on after a reset entry
+	i2cTrace_initialise();
+	if(resetFlags & ((1 << WDRF) | (1 << EXTRF))){
+		i2cTrace_dump(serialOutput_putChar, 0);
+	}
+#endif
+	sei();
+	//set up once for every device on the bus, the drivers only find it running
+	i2c_init(&myI2CRegisters, LCDSCREEN_I2C_CLOCK);
+	for (uint8_t i = 0; i < NUMBER_OF_SCREENS; ++i){
+		LcdScreenDriver_Context* screen = screens[i];
+		lcdScreenDriver_initialise(screen, &myI2CRegisters, screenAddresses[i], NUMBER_OF_COLUMNS, NUMBER_OF_ROWS, LCDSCREEN_TYPE_5x8DOTS);
+		lcdScreenDriver_initialiseScreenWarm(screen, powerWasLost);
+		lcdScreenDriver_setBacklightOn(screen);
+		lcdScreenDriver_setCursorOn(screen);
+	}
+
+	//the texts stay in flash, none of them takes RAM
+	lcdScreenDriver_bufferPrintString_P(screens[0], 0, 0, MEMORYABSTRACTION_FLASH_STRING("Hello Embedded\nSystems!"));
+	for (uint8_t i = 1; i < NUMBER_OF_SCREENS; ++i){
+		lcdScreenDriver_bufferPrintFormat_P(screens[i], 0, 0, MEMORYABSTRACTION_FLASH_STRING("Display %u"), i + 1);
 	}
-}
\ No newline at end of file
+
+	scheduler_addPeriodicTask(lcdRefreshTask, 0, LCD_REFRESH_PERIOD_US, 0);
+	scheduler_addPeriodicTask(letterTask, 0, LETTER_PERIOD_US, 1000000UL);
+	delayAbstraction_resetPowerStatistics();
+	scheduler_addPeriodicTask(powerTask, 0, POWER_PERIOD_US, POWER_PERIOD_US);
+#ifdef INTEGRATION_BME680
+	//the sensor shares the bus with the displays, its transfers queue up between theirs
+	if(bme680_initialise(&environmentSensor, BME680_ADDRESS_PRIMARY, BME680_OVERSAMPLING_2X, BME680_OVERSAMPLING_4X, BME680_OVERSAMPLING_1X, 2) == BME680_ERRORCODE_ALL_OK){
+		sensorPipeline_openCursor(&displayCursor);
+		sensorPipeline_openCursor(&logCursor);
+		sensorPipeline_start(&environmentSensor, SENSOR_PERIOD_US);
+		scheduler_addPeriodicTask(sensorDisplayTask, 0, SENSOR_DISPLAY_PERIOD_US, SENSOR_DISPLAY_PERIOD_US);
+		scheduler_addPeriodicTask(sensorLogTask, 0, SENSOR_LOG_PERIOD_US, SENSOR_LOG_PERIOD_US);
+	}
+	else{
+		lcdScreenDriver_bufferPrintString_P(screens[1], 0, SENSOR_ROW, MEMORYABSTRACTION_FLASH_STRING("no BME680"));
+	}
+#endif
+#ifdef PROFILING
+	scheduler_addPeriodicTask(profileDumpTask, 0, PROFILE_DUMP_PERIOD_US, PROFILE_DUMP_PERIOD_US);
+#endif
+	scheduler_run();
+}
+
+#endif // TEST
\ No newline at end of file
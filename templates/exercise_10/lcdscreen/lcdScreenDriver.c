@@ -3,20 +3,8 @@
 
 #include "i2cInterface.h"
 #include "delayAbstraction.h"
-
-#define LCDSCREEN_I2C_CLOCK 100000L
-
-uint8_t deviceAddress;
-
-uint8_t displayControlOptions;
-uint8_t displayModeOptions;
-uint8_t numberOfRows;
-uint8_t numberOfColumns;
-uint8_t characterType;
-uint8_t backlightState = LCDSCREEN_INTERNAL_BACKLIGHT_ON;
-uint8_t currentCursorPositionColumns;
-uint8_t currentCursorPositionRows;
-
+#include "memoryAbstraction.h"
+#include "profiler.h"
 
 // When the display powers up, it is configured as follows:
 //
@@ -37,174 +25,472 @@ uint8_t currentCursorPositionRows;
 // can't assume that its in that state when the library starts.
 #include <stdio.h>
 
-uint8_t lcdScreenDriver_initialise(I2C_Registers* registers, uint8_t lcdScreenI2CAddress, uint8_t columns, uint8_t rows, uint8_t characterDotsType){
-	if(lcdScreenI2CAddress == 0 || columns == 0 || rows == 0 || (characterDotsType != LCDSCREEN_TYPE_5x8DOTS && characterDotsType != LCDSCREEN_TYPE_5x10DOTS)){
+uint8_t lcdScreenDriver_initialise(LcdScreenDriver_Context* screen, I2C_Registers* registers, uint8_t lcdScreenI2CAddress, uint8_t columns, uint8_t rows, uint8_t characterDotsType){
+	if(lcdScreenI2CAddress == 0 || columns == 0 || rows == 0 || columns > LCDSCREEN_FRAMEBUFFER_MAX_COLUMNS || rows > LCDSCREEN_FRAMEBUFFER_MAX_ROWS || (characterDotsType != LCDSCREEN_TYPE_5x8DOTS && characterDotsType != LCDSCREEN_TYPE_5x10DOTS)){
 		return LCDSCREEN_ERRORCODE_INVALIDPARAMS;
 	}
 
+	//a context kept over a reset still describes the controller, as long as it is the same display
+	screen->warmStartAvailable = screen->warmSignature == LCDSCREEN_WARM_SIGNATURE && screen->deviceAddress == lcdScreenI2CAddress &&
+		screen->numberOfColumns == columns && screen->numberOfRows == rows && screen->characterType == characterDotsType;
+	//a reset before the configuration is complete must not leave a valid signature behind
+	screen->warmSignature = 0;
+
+	//only sets the bus up if nothing did before, the transfers of the other devices on it are kept
 	uint8_t errorcode = i2c_init(registers, LCDSCREEN_I2C_CLOCK);
 	if(errorcode != I2C_FUNCTIONCODES_NO_ERROR){
 		return errorcode;
 	}
+	errorcode = i2c_computeClockSetting(LCDSCREEN_I2C_CLOCK, &screen->clockSetting, 0);
+	if(errorcode != I2C_FUNCTIONCODES_NO_ERROR){
+		return errorcode;
+	}
 	
-	deviceAddress = lcdScreenI2CAddress;
-	numberOfRows = rows;
-	numberOfColumns = columns;
-	characterType = characterDotsType;
+	screen->deviceAddress = lcdScreenI2CAddress;
+	screen->numberOfRows = rows;
+	screen->numberOfColumns = columns;
+	screen->characterType = characterDotsType;
+	screen->displayControlOptions = 0;
+	screen->displayModeOptions = 0;
+	screen->backlightState = LCDSCREEN_INTERNAL_BACKLIGHT_ON;
+	screen->currentCursorPositionColumns = 0;
+	screen->currentCursorPositionRows = 0;
+	screen->busyFlagPolling = 0;
+	delayAbstraction_startTimeout(&screen->controllerReady, 0);
+	//CGRAM content is unknown until the first upload
+	for (uint8_t slot = 0; slot < LCDSCREEN_GLYPH_SLOTS; ++slot){
+		screen->glyphSlots[slot].glyph = 0;
+		screen->glyphSlots[slot].lastUse = 0;
+		screen->glyphSlots[slot].uploadPending = 0;
+	}
+	screen->glyphUseCounter = 0;
+	screen->marqueeStepMicros = 0;
+	lcdScreenDriverInternal_resetDisplayShift(screen);
+	screen->updateDepth = 0;
+	screen->lastError = I2C_CODES_NO_ERROR;
+	screen->failedTransfers = 0;
+	lcdScreenDriverInternal_forgetControllerState(screen);
+	screen->panelContentValid = 0;
+	lcdScreenDriver_bufferClear(screen);
 	return LCDSCREEN_ERRORCODE_ALL_OK;
 }
 
-void lcdScreenDriver_initialiseScreenToKnownState(void){
-	backlightState = LCDSCREEN_INTERNAL_BACKLIGHT_ON;
+void lcdScreenDriver_initialiseScreenToKnownState(LcdScreenDriver_Context* screen){
+	screen->backlightState = LCDSCREEN_INTERNAL_BACKLIGHT_ON;
+	lcdScreenDriverInternal_forgetControllerState(screen);
 
 	delayAbstraction_delayMilliseconds(50);
-	lcdScreenDriverInternal_writeWithCurrentBacklightSetting(0);
+	lcdScreenDriverInternal_writeWithCurrentBacklightSetting(screen, 0);
 	delayAbstraction_delayMilliseconds(1000);
 
 
 	//Do the waiting long twice
-	lcdScreenDriverInternal_writeNibble(LCDSCREEN_INTERFACE_4BITMODE_A, LCDSCREEN_SENDING_MODE_COMMAND);
+	lcdScreenDriverInternal_writeNibble(screen, LCDSCREEN_INTERFACE_4BITMODE_A, LCDSCREEN_SENDING_MODE_COMMAND);
 	delayAbstraction_delayMicroseconds(LCDSCREEN_INTERFACE_4BITMODE_DELAY_LONG_US);
-	lcdScreenDriverInternal_writeNibble(LCDSCREEN_INTERFACE_4BITMODE_A, LCDSCREEN_SENDING_MODE_COMMAND);
+	lcdScreenDriverInternal_writeNibble(screen, LCDSCREEN_INTERFACE_4BITMODE_A, LCDSCREEN_SENDING_MODE_COMMAND);
 	delayAbstraction_delayMicroseconds(LCDSCREEN_INTERFACE_4BITMODE_DELAY_LONG_US);
 
 	//Then wait for a short time	
-	lcdScreenDriverInternal_writeNibble(LCDSCREEN_INTERFACE_4BITMODE_A, LCDSCREEN_SENDING_MODE_COMMAND);
+	lcdScreenDriverInternal_writeNibble(screen, LCDSCREEN_INTERFACE_4BITMODE_A, LCDSCREEN_SENDING_MODE_COMMAND);
 	delayAbstraction_delayMicroseconds(LCDSCREEN_INTERFACE_4BITMODE_DELAY_SHORT_US);
 
 	//then finally set it to 4bit with this
-	lcdScreenDriverInternal_writeNibble(LCDSCREEN_INTERFACE_4BITMODE_B, LCDSCREEN_SENDING_MODE_COMMAND);
+	lcdScreenDriverInternal_writeNibble(screen, LCDSCREEN_INTERFACE_4BITMODE_B, LCDSCREEN_SENDING_MODE_COMMAND);
+
+	lcdScreenDriverInternal_configureController(screen);
+	//clear the screen
+	lcdScreenDriver_clearDisplay(screen);
+	lcdScreenDriver_setCursorHome(screen);
+	screen->warmSignature = LCDSCREEN_WARM_SIGNATURE;
+}
+
+uint8_t lcdScreenDriver_initialiseScreenWarm(LcdScreenDriver_Context* screen, uint8_t powerWasLost){
+	if(powerWasLost || !screen->warmStartAvailable){
+		lcdScreenDriver_initialiseScreenToKnownState(screen);
+		return 0;
+	}
+	screen->backlightState = LCDSCREEN_INTERNAL_BACKLIGHT_ON;
+	lcdScreenDriverInternal_forgetControllerState(screen);
+	screen->warmSignature = 0;
 
+	/*
+		The reset may have come between the two nibbles of a byte. Three 8-bit function sets bring the controller
+		into 8-bit mode from either nibble position: if it waited for a low nibble the first one completes that byte
+		as some command, the worst of them is a home, so the first wait covers its execution time.
+	*/
+	lcdScreenDriverInternal_writeNibble(screen, LCDSCREEN_INTERFACE_4BITMODE_A, LCDSCREEN_SENDING_MODE_COMMAND);
+	delayAbstraction_delayMicroseconds(LCDSCREEN_CLEAR_HOME_DELAY_US);
+	lcdScreenDriverInternal_writeNibble(screen, LCDSCREEN_INTERFACE_4BITMODE_A, LCDSCREEN_SENDING_MODE_COMMAND);
+	delayAbstraction_delayMicroseconds(LCDSCREEN_RESYNC_DELAY_US);
+	lcdScreenDriverInternal_writeNibble(screen, LCDSCREEN_INTERFACE_4BITMODE_A, LCDSCREEN_SENDING_MODE_COMMAND);
+	delayAbstraction_delayMicroseconds(LCDSCREEN_RESYNC_DELAY_US);
+	lcdScreenDriverInternal_writeNibble(screen, LCDSCREEN_INTERFACE_4BITMODE_B, LCDSCREEN_SENDING_MODE_COMMAND);
+
+	lcdScreenDriverInternal_configureController(screen);
+	//home undoes a display shift the marquee may have left, DDRAM and what the panel shows stay as they are
+	lcdScreenDriver_setCursorHome(screen);
+	screen->panelContentValid = 0;
+	screen->warmSignature = LCDSCREEN_WARM_SIGNATURE;
+	return 1;
+}
+
+//Function set, display control and entry mode of a freshly synchronised 4-bit interface
+void lcdScreenDriverInternal_configureController(LcdScreenDriver_Context* screen){
 	//Screen functionality being set
 	uint8_t functionOptions = LCDSCREEN_FUNCTIONALITY_4BITMODE | LCDSCREEN_FUNCTIONALITY_1LINE | LCDSCREEN_TYPE_5x8DOTS;
-	if(numberOfRows > 1){
+	if(screen->numberOfRows > 1){
 		functionOptions |= LCDSCREEN_FUNCTIONALITY_2LINE;
 	}
-	if(characterType == LCDSCREEN_TYPE_5x10DOTS && numberOfRows == LCDSCREEN_FUNCTIONALITY_1LINE){
-		functionOptions |= LCDSCREEN_TYPE_5x10DOTS;
+	if(lcdScreenDriverInternal_usesTallFont(screen)){
+		functionOptions |= LCDSCREEN_FUNCTIONALITY_RESOLUTION_5X10DOTS;
 	}
-	lcdScreenDriver_setScreenFunctionOptions(functionOptions);
+	lcdScreenDriver_setScreenFunctionOptions(screen, functionOptions);
 	//Turn display on, cursor and blinking off
 	uint8_t controlOptions = (1 << LCDSCREEN_CONTROL_DISPLAY_ON_BIT);
-	lcdScreenDriver_setDisplayControlOptions(controlOptions);
-
-	//clear the screen
-	lcdScreenDriver_clearDisplay();
+	lcdScreenDriver_setDisplayControlOptions(screen, controlOptions);
 
 	//set the display mode to roman languages
-	uint8_t displayModeOptions = (1 << LCDSCREEN_MODE_READ_LEFTTORIGHT_BIT);
-	lcdScreenDriver_setDisplayMode(displayModeOptions);
-	lcdScreenDriver_setCursorHome();
+	uint8_t modeOptions = (1 << LCDSCREEN_MODE_READ_LEFTTORIGHT_BIT);
+	lcdScreenDriver_setDisplayMode(screen, modeOptions);
 }
 
-void lcdScreenDriver_setBacklightOn(void){
-	backlightState = LCDSCREEN_INTERNAL_BACKLIGHT_ON;
-	lcdScreenDriverInternal_writeWithCurrentBacklightSetting(0);
+void lcdScreenDriver_setBacklightOn(LcdScreenDriver_Context* screen){
+	screen->backlightState = LCDSCREEN_INTERNAL_BACKLIGHT_ON;
+	lcdScreenDriverInternal_commitBacklight(screen);
 }
 
-void lcdScreenDriver_setBacklightOff(void){
-	backlightState = LCDSCREEN_INTERNAL_BACKLIGHT_OFF;
-	lcdScreenDriverInternal_writeWithCurrentBacklightSetting(0);
+void lcdScreenDriver_setBacklightOff(LcdScreenDriver_Context* screen){
+	screen->backlightState = LCDSCREEN_INTERNAL_BACKLIGHT_OFF;
+	lcdScreenDriverInternal_commitBacklight(screen);
 }
 
-void lcdScreenDriver_setDisplayControlOptions(uint8_t controlOptions){
-	displayControlOptions = controlOptions;
-	lcdScreenDriverInternal_writeCommandByte(LCDSCREEN_COMMAND_SETDISPLAYCONTROL | displayControlOptions);
+void lcdScreenDriver_setDisplayControlOptions(LcdScreenDriver_Context* screen, uint8_t controlOptions){
+	screen->displayControlOptions = controlOptions;
+	lcdScreenDriverInternal_commitDisplayControl(screen);
 }
 
-void lcdScreenDriver_setDisplayMode(uint8_t modeOptions){
-	displayModeOptions = modeOptions;
-	lcdScreenDriverInternal_writeCommandByte(displayModeOptions | LCDSCREEN_COMMAND_SETMODE);
+void lcdScreenDriver_setDisplayMode(LcdScreenDriver_Context* screen, uint8_t modeOptions){
+	screen->displayModeOptions = modeOptions;
+	lcdScreenDriverInternal_commitDisplayMode(screen);
 }
 
-void lcdScreenDriver_setScreenFunctionOptions(uint8_t functionOptions){
-	lcdScreenDriverInternal_writeCommandByte(functionOptions | LCDSCREEN_FUNCTIONALITY_COMMAND);
+void lcdScreenDriver_setScreenFunctionOptions(LcdScreenDriver_Context* screen, uint8_t functionOptions){
+	lcdScreenDriverInternal_writeCommandByte(screen, functionOptions | LCDSCREEN_FUNCTIONALITY_COMMAND);
 }
 
-void lcdScreenDriver_turnDisplayOn(void){
-	displayControlOptions |= (1 << LCDSCREEN_CONTROL_DISPLAY_ON_BIT);
-	lcdScreenDriverInternal_writeCommandByte(LCDSCREEN_COMMAND_SETDISPLAYCONTROL | displayControlOptions);
+void lcdScreenDriver_turnDisplayOn(LcdScreenDriver_Context* screen){
+	screen->displayControlOptions |= (1 << LCDSCREEN_CONTROL_DISPLAY_ON_BIT);
+	lcdScreenDriverInternal_commitDisplayControl(screen);
 }
 
-void lcdScreenDriver_turnDisplayOff(void){
-	displayControlOptions &= ~(1 << LCDSCREEN_CONTROL_DISPLAY_ON_BIT);
-	lcdScreenDriverInternal_writeCommandByte(LCDSCREEN_COMMAND_SETDISPLAYCONTROL | displayControlOptions);
+void lcdScreenDriver_turnDisplayOff(LcdScreenDriver_Context* screen){
+	screen->displayControlOptions &= ~(1 << LCDSCREEN_CONTROL_DISPLAY_ON_BIT);
+	lcdScreenDriverInternal_commitDisplayControl(screen);
 }
 
-void lcdScreenDriver_clearDisplay(void){
-	lcdScreenDriverInternal_writeCommandByte(LCDSCREEN_COMMAND_CLEAR_DISPLAY);
-	delayAbstraction_delayMilliseconds(2);
+void lcdScreenDriver_clearDisplay(LcdScreenDriver_Context* screen){
+	screen->currentCursorPositionColumns = 0;
+	screen->currentCursorPositionRows = 0;
+	screen->pendingCursorAddress = LCDSCREEN_STATE_UNKNOWN;
+	uint8_t failedTransfers = screen->failedTransfers;
+	lcdScreenDriverInternal_writeCommandByte(screen, LCDSCREEN_COMMAND_CLEAR_DISPLAY);
+	delayAbstraction_startTimeout(&screen->controllerReady, LCDSCREEN_CLEAR_HOME_DELAY_US);
+	lcdScreenDriverInternal_resetDisplayShift(screen);
+	//a clear also fills the shadow copies with blanks, so a flush right after does not resend them
+	lcdScreenDriver_bufferClear(screen);
+	lcdScreenDriverInternal_fillShadow(screen->panelContent, ' ');
+	screen->panelContentValid = (screen->failedTransfers == failedTransfers);
 }
 
-void lcdScreenDriver_setCursorHome(void){
-	currentCursorPositionColumns = 0;
-	currentCursorPositionRows = 0;
-	lcdScreenDriverInternal_writeCommandByte(LCDSCREEN_COMMAND_MOVE_CURSOR_HOME);
-	delayAbstraction_delayMilliseconds(2);
+void lcdScreenDriver_setCursorHome(LcdScreenDriver_Context* screen){
+	screen->currentCursorPositionColumns = 0;
+	screen->currentCursorPositionRows = 0;
+	screen->pendingCursorAddress = LCDSCREEN_STATE_UNKNOWN;
+	lcdScreenDriverInternal_writeCommandByte(screen, LCDSCREEN_COMMAND_MOVE_CURSOR_HOME);
+	delayAbstraction_startTimeout(&screen->controllerReady, LCDSCREEN_CLEAR_HOME_DELAY_US);
+	lcdScreenDriverInternal_resetDisplayShift(screen);
 }
 
-void lcdScreenDriver_setCursorPosition(uint8_t cursorPositionColumn, uint8_t cursorPositionRow){
+void lcdScreenDriver_setCursorPosition(LcdScreenDriver_Context* screen, uint8_t cursorPositionColumn, uint8_t cursorPositionRow){
 	uint16_t rowOffsets[] = {0x00, 0x40};
-	if(cursorPositionColumn >= numberOfColumns){
-		cursorPositionColumn = numberOfColumns - 1;
+	if(cursorPositionColumn >= screen->numberOfColumns){
+		cursorPositionColumn = screen->numberOfColumns - 1;
 	}
-	if(cursorPositionRow >= numberOfRows){
-		cursorPositionRow = numberOfRows - 1;
+	if(cursorPositionRow >= screen->numberOfRows){
+		cursorPositionRow = screen->numberOfRows - 1;
 	}
-	currentCursorPositionColumns = cursorPositionColumn;
-	currentCursorPositionRows = cursorPositionRow;
-	lcdScreenDriverInternal_writeCommandByte(LCDSCREEN_COMMAND_SET_DDRAM_ADDR | (cursorPositionColumn + rowOffsets[cursorPositionRow]));
+	screen->currentCursorPositionColumns = cursorPositionColumn;
+	screen->currentCursorPositionRows = cursorPositionRow;
+	screen->pendingCursorAddress = cursorPositionColumn + rowOffsets[cursorPositionRow];
+	lcdScreenDriverInternal_commitCursorAddress(screen);
 }
 
-void lcdScreenDriver_setCursorOff(void){
-	displayControlOptions &= ~(1 << LCDSCREEN_CONTROL_CURSOR_ON_BIT);
-	lcdScreenDriver_setDisplayControlOptions(displayControlOptions);
+void lcdScreenDriver_setCursorOff(LcdScreenDriver_Context* screen){
+	screen->displayControlOptions &= ~(1 << LCDSCREEN_CONTROL_CURSOR_ON_BIT);
+	lcdScreenDriver_setDisplayControlOptions(screen, screen->displayControlOptions);
 }
 
-void lcdScreenDriver_setCursorOn(void){
-	displayControlOptions |= (1 << LCDSCREEN_CONTROL_CURSOR_ON_BIT);
-	lcdScreenDriver_setDisplayControlOptions(displayControlOptions);
+void lcdScreenDriver_setCursorOn(LcdScreenDriver_Context* screen){
+	screen->displayControlOptions |= (1 << LCDSCREEN_CONTROL_CURSOR_ON_BIT);
+	lcdScreenDriver_setDisplayControlOptions(screen, screen->displayControlOptions);
 }
 
-void lcdScreenDriver_setBlinkOff(void){
-	displayControlOptions &= ~(1 << LCDSCREEN_CONTROL_BLINK_ON_BIT);
-	lcdScreenDriver_setDisplayControlOptions(displayControlOptions);
+void lcdScreenDriver_setBlinkOff(LcdScreenDriver_Context* screen){
+	screen->displayControlOptions &= ~(1 << LCDSCREEN_CONTROL_BLINK_ON_BIT);
+	lcdScreenDriver_setDisplayControlOptions(screen, screen->displayControlOptions);
 }
 
-void lcdScreenDriver_setBlinkOn(void){
-	displayControlOptions |= (1 << LCDSCREEN_CONTROL_BLINK_ON_BIT);
-	lcdScreenDriver_setDisplayControlOptions(displayControlOptions);
+void lcdScreenDriver_setBlinkOn(LcdScreenDriver_Context* screen){
+	screen->displayControlOptions |= (1 << LCDSCREEN_CONTROL_BLINK_ON_BIT);
+	lcdScreenDriver_setDisplayControlOptions(screen, screen->displayControlOptions);
 }
 
-void lcdScreenDriver_setTextFlow(uint8_t textFlowDirection){
+void lcdScreenDriver_setTextFlow(LcdScreenDriver_Context* screen, uint8_t textFlowDirection){
 	if(textFlowDirection){
-		displayModeOptions |= (1 << LCDSCREEN_MODE_READ_LEFTTORIGHT_BIT);
+		screen->displayModeOptions |= (1 << LCDSCREEN_MODE_READ_LEFTTORIGHT_BIT);
 	}
 	else{
-		displayModeOptions &= ~(1 << LCDSCREEN_MODE_READ_LEFTTORIGHT_BIT);
+		screen->displayModeOptions &= ~(1 << LCDSCREEN_MODE_READ_LEFTTORIGHT_BIT);
 	}
-	lcdScreenDriver_setDisplayMode(displayModeOptions);
+	lcdScreenDriver_setDisplayMode(screen, screen->displayModeOptions);
 }
 
-void lcdScreenDriver_printChar(char c){
+void lcdScreenDriver_printChar(LcdScreenDriver_Context* screen, char c){
 	if(c == '\n'){
-		lcdScreenDriver_setCursorPosition(0, (currentCursorPositionRows+1) % numberOfRows);
+		lcdScreenDriver_setCursorPosition(screen, 0, (screen->currentCursorPositionRows+1) % screen->numberOfRows);
 		return;
 	}
-	if(currentCursorPositionColumns>=numberOfColumns){
-		lcdScreenDriver_setCursorPosition(0, (currentCursorPositionRows+1) % numberOfRows);
+	if(screen->currentCursorPositionColumns>=screen->numberOfColumns){
+		lcdScreenDriver_setCursorPosition(screen, 0, (screen->currentCursorPositionRows+1) % screen->numberOfRows);
+	}
+	//direct writes keep both shadow copies in sync, a later flush must not undo them
+	if(screen->currentCursorPositionColumns < screen->numberOfColumns){
+		screen->screenBuffer[screen->currentCursorPositionRows][screen->currentCursorPositionColumns] = c;
+		screen->panelContent[screen->currentCursorPositionRows][screen->currentCursorPositionColumns] = c;
 	}
-	lcdScreenDriverInternal_writeDataByte(c);
-	currentCursorPositionColumns++;
+	lcdScreenDriverInternal_writeDataByte(screen, c);
+	screen->currentCursorPositionColumns++;
 }
 
-void lcdScreenDriver_printString(char* string){
+void lcdScreenDriver_beginUpdate(LcdScreenDriver_Context* screen){
+	screen->updateDepth++;
+}
+
+void lcdScreenDriver_commitUpdate(LcdScreenDriver_Context* screen){
+	if(screen->updateDepth == 0 || --screen->updateDepth){
+		return;
+	}
+	lcdScreenDriverInternal_commitDisplayControl(screen);
+	lcdScreenDriverInternal_commitDisplayMode(screen);
+	lcdScreenDriverInternal_commitBacklight(screen);
+	lcdScreenDriverInternal_commitCursorAddress(screen);
+}
+
+void lcdScreenDriver_printString(LcdScreenDriver_Context* screen, char* string){
+	while(*string){
+		if(*string == '\n' || screen->currentCursorPositionColumns >= screen->numberOfColumns){
+			lcdScreenDriver_printChar(screen, *(string++));
+			continue;
+		}
+		//send everything up to the next line break or the end of the row in one transfer
+		uint8_t runLength = 0;
+		while(string[runLength] && string[runLength] != '\n' && screen->currentCursorPositionColumns + runLength < screen->numberOfColumns){
+			screen->screenBuffer[screen->currentCursorPositionRows][screen->currentCursorPositionColumns + runLength] = string[runLength];
+			screen->panelContent[screen->currentCursorPositionRows][screen->currentCursorPositionColumns + runLength] = string[runLength];
+			runLength++;
+		}
+		lcdScreenDriverInternal_writeByteSequence(screen, (uint8_t*) string, runLength, LCDSCREEN_SENDING_MODE_DATA);
+		screen->currentCursorPositionColumns += runLength;
+		string += runLength;
+	}
+}
+
+uint8_t lcdScreenDriver_getLastError(LcdScreenDriver_Context* screen){
+	uint8_t errorcode = screen->lastError;
+	screen->lastError = I2C_CODES_NO_ERROR;
+	return errorcode;
+}
+
+uint8_t lcdScreenDriver_isReady(LcdScreenDriver_Context* screen){
+	if(delayAbstraction_hasExpired(&screen->controllerReady)){
+		return 1;
+	}
+	if(screen->busyFlagPolling && !lcdScreenDriverInternal_isBusy(screen)){
+		screen->controllerReady.duration = 0;
+		return 1;
+	}
+	return 0;
+}
+
+void lcdScreenDriver_setBusyFlagPolling(LcdScreenDriver_Context* screen, uint8_t enabled){
+	screen->busyFlagPolling = enabled;
+}
+
+uint8_t lcdScreenDriver_setI2CClock(LcdScreenDriver_Context* screen, uint32_t clockspeed, uint32_t* actualClockspeed){
+	I2C_ClockSetting newSetting;
+	if(i2c_computeClockSetting(clockspeed, &newSetting, actualClockspeed) != I2C_FUNCTIONCODES_NO_ERROR){
+		return LCDSCREEN_ERRORCODE_INVALIDPARAMS;
+	}
+	screen->clockSetting = newSetting;
+	return LCDSCREEN_ERRORCODE_ALL_OK;
+}
+
+void lcdScreenDriver_bufferClear(LcdScreenDriver_Context* screen){
+	lcdScreenDriverInternal_fillShadow(screen->screenBuffer, ' ');
+}
+
+void lcdScreenDriver_bufferSetChar(LcdScreenDriver_Context* screen, uint8_t column, uint8_t row, char c){
+	if(column >= screen->numberOfColumns || row >= screen->numberOfRows){
+		return;
+	}
+	screen->screenBuffer[row][column] = c;
+}
+
+void lcdScreenDriver_bufferPrintString(LcdScreenDriver_Context* screen, uint8_t column, uint8_t row, char* string){
 	char currentChar;
 	while((currentChar = *(string++))){
-		lcdScreenDriver_printChar(currentChar);
+		if(currentChar == '\n'){
+			column = 0;
+			row++;
+			continue;
+		}
+		if(column >= screen->numberOfColumns){
+			column = 0;
+			row++;
+		}
+		if(row >= screen->numberOfRows){
+			return;
+		}
+		screen->screenBuffer[row][column++] = currentChar;
 	}
 }
 
+uint8_t lcdScreenDriver_bufferSetGlyph(LcdScreenDriver_Context* screen, uint8_t column, uint8_t row, const uint8_t* glyph){
+	if(glyph == 0 || column >= screen->numberOfColumns || row >= screen->numberOfRows){
+		return LCDSCREEN_ERRORCODE_INVALIDPARAMS;
+	}
+	uint8_t slot;
+	uint8_t errorcode = lcdScreenDriverInternal_acquireGlyphSlot(screen, glyph, &slot);
+	if(errorcode){
+		return errorcode;
+	}
+	screen->screenBuffer[row][column] = lcdScreenDriverInternal_glyphCharacterCode(screen, slot);
+	return LCDSCREEN_ERRORCODE_ALL_OK;
+}
+
+uint8_t lcdScreenDriver_printGlyph(LcdScreenDriver_Context* screen, const uint8_t* glyph){
+	if(glyph == 0){
+		return LCDSCREEN_ERRORCODE_INVALIDPARAMS;
+	}
+	uint8_t slot;
+	uint8_t errorcode = lcdScreenDriverInternal_acquireGlyphSlot(screen, glyph, &slot);
+	if(errorcode){
+		return errorcode;
+	}
+	lcdScreenDriverInternal_uploadPendingGlyphs(screen);
+	lcdScreenDriver_printChar(screen, lcdScreenDriverInternal_glyphCharacterCode(screen, slot));
+	return LCDSCREEN_ERRORCODE_ALL_OK;
+}
+
+void lcdScreenDriver_flush(LcdScreenDriver_Context* screen){
+	//the cells of a shifted display are not at their framebuffer addresses
+	if(screen->marqueeRunning){
+		return;
+	}
+	PROFILE_BEGIN(PROFILE_LCD_FLUSH);
+	uint8_t failedTransfers = screen->failedTransfers;
+	//the cells refer to CGRAM slots, their patterns have to be in place first
+	lcdScreenDriverInternal_uploadPendingGlyphs(screen);
+	for (uint8_t row = 0; row < screen->numberOfRows; ++row){
+		uint8_t column = 0;
+		while(column < screen->numberOfColumns){
+			if(!lcdScreenDriverInternal_isCellDirty(screen, column, row)){
+				column++;
+				continue;
+			}
+			//extend the run over short stretches of clean cells, resending them is cheaper than a new address command
+			uint8_t runStart = column;
+			uint8_t runEnd = column;
+			for (uint8_t next = column + 1; next < screen->numberOfColumns && next <= runEnd + LCDSCREEN_FLUSH_MAX_CLEAN_GAP + 1; ++next){
+				if(lcdScreenDriverInternal_isCellDirty(screen, next, row)){
+					runEnd = next;
+				}
+			}
+			lcdScreenDriverInternal_flushRun(screen, runStart, runEnd, row);
+			column = runEnd + 1;
+		}
+	}
+	//after a failed transfer the panel may show anything, the next flush sends every cell again
+	if(screen->failedTransfers == failedTransfers){
+		screen->panelContentValid = 1;
+	}
+	PROFILE_END(PROFILE_LCD_FLUSH);
+}
+
+void lcdScreenDriver_flushAll(LcdScreenDriver_Context** screens, uint8_t numberOfScreens){
+	for (uint8_t i = 0; i < numberOfScreens; ++i){
+		if(lcdScreenDriver_isReady(screens[i])){
+			lcdScreenDriver_flush(screens[i]);
+		}
+	}
+	//by now the busy ones had the bus time of the others to finish, a display flushed above has nothing left to send
+	for (uint8_t i = 0; i < numberOfScreens; ++i){
+		lcdScreenDriver_flush(screens[i]);
+	}
+}
+
+uint8_t lcdScreenDriver_setMarqueeText(LcdScreenDriver_Context* screen, uint8_t row, const char* text){
+	if(row >= screen->numberOfRows || !(screen->displayModeOptions & (1 << LCDSCREEN_MODE_READ_LEFTTORIGHT_BIT))){
+		return LCDSCREEN_ERRORCODE_INVALIDPARAMS;
+	}
+	LcdScreenDriver_MarqueeRow* marqueeRow = &screen->marqueeRows[row];
+	marqueeRow->text = text;
+	marqueeRow->textLength = 0;
+	while(text && text[marqueeRow->textLength]){
+		marqueeRow->textLength++;
+	}
+	marqueeRow->textPosition = 0;
+	lcdScreenDriverInternal_loadMarqueeRow(screen, row);
+	//the line no longer holds the framebuffer content
+	screen->panelContentValid = 0;
+	return LCDSCREEN_ERRORCODE_ALL_OK;
+}
+
+void lcdScreenDriver_startMarquee(LcdScreenDriver_Context* screen, uint32_t stepPeriodMicros){
+	screen->marqueeStepMicros = stepPeriodMicros;
+	screen->marqueeRunning = 1;
+	delayAbstraction_startTimeout(&screen->marqueeStep, stepPeriodMicros);
+}
+
+uint8_t lcdScreenDriver_serviceMarquee(LcdScreenDriver_Context* screen){
+	if(!screen->marqueeRunning || !delayAbstraction_hasExpired(&screen->marqueeStep)){
+		return 0;
+	}
+	delayAbstraction_startTimeout(&screen->marqueeStep, screen->marqueeStepMicros);
+	uint8_t rowOffsets[] = {0x00, 0x40};
+	uint8_t lineLength = lcdScreenDriverInternal_ddramLineLength(screen);
+	for (uint8_t row = 0; row < screen->numberOfRows; ++row){
+		LcdScreenDriver_MarqueeRow* marqueeRow = &screen->marqueeRows[row];
+		if(marqueeRow->text == 0 || marqueeRow->textLength <= lineLength){
+			continue;
+		}
+		//the column right of the screen still holds the character that left it one line length ago
+		uint8_t address = (screen->displayShiftOffset + screen->numberOfColumns) % lineLength;
+		lcdScreenDriverInternal_writeCommandByte(screen, LCDSCREEN_COMMAND_SET_DDRAM_ADDR | (rowOffsets[row] + address));
+		lcdScreenDriverInternal_writeDataByte(screen, lcdScreenDriverInternal_marqueeCharacter(screen, row, marqueeRow->textPosition + screen->numberOfColumns));
+		marqueeRow->textPosition = (marqueeRow->textPosition + 1) % marqueeRow->textLength;
+		screen->currentCursorPositionColumns = LCDSCREEN_CURSOR_UNKNOWN;
+	}
+	lcdScreenDriverInternal_writeCommandByte(screen, LCDSCREEN_COMMAND_SHIFT | LCDSCREEN_SHIFT_DISPLAY);
+	screen->displayShiftOffset = (screen->displayShiftOffset + 1) % lineLength;
+	return 1;
+}
+
+void lcdScreenDriver_stopMarquee(LcdScreenDriver_Context* screen){
+	//home also undoes the display shift
+	lcdScreenDriver_setCursorHome(screen);
+	screen->panelContentValid = 0;
+}
 
 
 // void lcdscreendriver_printChar(char c){
@@ -213,51 +499,501 @@ void lcdScreenDriver_printString(char* string){
 
 //##################################
 //Internal applications
-void lcdScreenDriverInternal_writeWithCurrentBacklightSetting(uint8_t dataToWrite){
+void lcdScreenDriverInternal_fillShadow(char shadow[LCDSCREEN_FRAMEBUFFER_MAX_ROWS][LCDSCREEN_FRAMEBUFFER_MAX_COLUMNS], char c){
+	for (uint8_t row = 0; row < LCDSCREEN_FRAMEBUFFER_MAX_ROWS; ++row){
+		for (uint8_t column = 0; column < LCDSCREEN_FRAMEBUFFER_MAX_COLUMNS; ++column){
+			shadow[row][column] = c;
+		}
+	}
+}
+
+uint8_t lcdScreenDriverInternal_isCellDirty(LcdScreenDriver_Context* screen, uint8_t column, uint8_t row){
+	return !screen->panelContentValid || screen->screenBuffer[row][column] != screen->panelContent[row][column];
+}
+
+//The 5x10 font is only available on single line displays
+uint8_t lcdScreenDriverInternal_usesTallFont(LcdScreenDriver_Context* screen){
+	return screen->characterType == LCDSCREEN_TYPE_5x10DOTS && screen->numberOfRows == 1;
+}
+
+//With the 5x10 font bit 0 of the character code is ignored, slot n is code 2n
+uint8_t lcdScreenDriverInternal_glyphCharacterCode(LcdScreenDriver_Context* screen, uint8_t slot){
+	return lcdScreenDriverInternal_usesTallFont(screen) ? slot << 1 : slot;
+}
+
+uint8_t lcdScreenDriverInternal_isGlyphInBuffer(LcdScreenDriver_Context* screen, uint8_t slot){
+	char characterCode = lcdScreenDriverInternal_glyphCharacterCode(screen, slot);
+	for (uint8_t row = 0; row < screen->numberOfRows; ++row){
+		for (uint8_t column = 0; column < screen->numberOfColumns; ++column){
+			if(screen->screenBuffer[row][column] == characterCode){
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+uint8_t lcdScreenDriverInternal_acquireGlyphSlot(LcdScreenDriver_Context* screen, const uint8_t* glyph, uint8_t* slot){
+	uint8_t numberOfSlots = lcdScreenDriverInternal_usesTallFont(screen) ? LCDSCREEN_GLYPH_SLOTS_5x10 : LCDSCREEN_GLYPH_SLOTS;
+	uint8_t freeSlot = LCDSCREEN_GLYPH_NO_SLOT;
+	uint8_t leastRecentlyUsedSlot = LCDSCREEN_GLYPH_NO_SLOT;
+	uint8_t chosenSlot = LCDSCREEN_GLYPH_NO_SLOT;
+	for (uint8_t candidate = 0; candidate < numberOfSlots; ++candidate){
+		LcdScreenDriver_GlyphSlot* glyphSlot = &screen->glyphSlots[candidate];
+		if(glyphSlot->glyph == glyph){
+			chosenSlot = candidate;
+			break;
+		}
+		if(glyphSlot->glyph == 0){
+			if(freeSlot == LCDSCREEN_GLYPH_NO_SLOT){
+				freeSlot = candidate;
+			}
+			continue;
+		}
+		//a slot that cells of the framebuffer still refer to would change them as well
+		if(lcdScreenDriverInternal_isGlyphInBuffer(screen, candidate)){
+			continue;
+		}
+		if(leastRecentlyUsedSlot == LCDSCREEN_GLYPH_NO_SLOT || glyphSlot->lastUse < screen->glyphSlots[leastRecentlyUsedSlot].lastUse){
+			leastRecentlyUsedSlot = candidate;
+		}
+	}
+	if(chosenSlot == LCDSCREEN_GLYPH_NO_SLOT){
+		chosenSlot = freeSlot != LCDSCREEN_GLYPH_NO_SLOT ? freeSlot : leastRecentlyUsedSlot;
+		if(chosenSlot == LCDSCREEN_GLYPH_NO_SLOT){
+			return LCDSCREEN_ERRORCODE_NO_GLYPH_SLOT;
+		}
+		screen->glyphSlots[chosenSlot].glyph = glyph;
+		screen->glyphSlots[chosenSlot].uploadPending = 1;
+	}
+
+	if(++screen->glyphUseCounter == 0){
+		//the counter wrapped, start the ages over
+		for (uint8_t i = 0; i < LCDSCREEN_GLYPH_SLOTS; ++i){
+			screen->glyphSlots[i].lastUse = 0;
+		}
+		screen->glyphUseCounter = 1;
+	}
+	screen->glyphSlots[chosenSlot].lastUse = screen->glyphUseCounter;
+	*slot = chosenSlot;
+	return LCDSCREEN_ERRORCODE_ALL_OK;
+}
+
+void lcdScreenDriverInternal_uploadPendingGlyphs(LcdScreenDriver_Context* screen){
+	uint8_t tallFont = lcdScreenDriverInternal_usesTallFont(screen);
+	uint8_t glyphRows = tallFont ? LCDSCREEN_GLYPH_ROWS_5x10 : LCDSCREEN_GLYPH_ROWS_5x8;
+	//a 5x10 slot is 16 bytes of CGRAM, the row below the bitmap is where the cursor line shows
+	uint8_t uploadRows = tallFont ? LCDSCREEN_GLYPH_ROWS_5x10 + 1 : LCDSCREEN_GLYPH_ROWS_5x8;
+	uint8_t leftToRight = screen->displayModeOptions & (1 << LCDSCREEN_MODE_READ_LEFTTORIGHT_BIT);
+	uint8_t cursorAddress = screen->pendingCursorAddress;
+	uint8_t uploaded = 0;
+	for (uint8_t slot = 0; slot < LCDSCREEN_GLYPH_SLOTS; ++slot){
+		LcdScreenDriver_GlyphSlot* glyphSlot = &screen->glyphSlots[slot];
+		if(!glyphSlot->uploadPending){
+			continue;
+		}
+		uint8_t pattern[LCDSCREEN_GLYPH_ROWS_5x10 + 1];
+		for (uint8_t row = 0; row < uploadRows; ++row){
+			uint8_t pixels = row < glyphRows ? memoryAbstraction_readFlashByte(glyphSlot->glyph + row) & LCDSCREEN_GLYPH_ROW_MASK : 0;
+			//the address counter follows the entry mode in CGRAM too, right to left writes the rows bottom up
+			pattern[leftToRight ? row : uploadRows - 1 - row] = pixels;
+		}
+		uint8_t address = slot << (tallFont ? 4 : 3);
+		if(!leftToRight){
+			address += uploadRows - 1;
+		}
+		if(!uploaded){
+			//a cursor move still waiting must not follow the CGRAM address, it would take the pattern to DDRAM
+			if(cursorAddress == LCDSCREEN_STATE_UNKNOWN){
+				cursorAddress = screen->controllerAddressCounter;
+			}
+			if(cursorAddress == LCDSCREEN_STATE_UNKNOWN && screen->currentCursorPositionColumns != LCDSCREEN_CURSOR_UNKNOWN){
+				uint8_t rowOffsets[] = {0x00, 0x40};
+				cursorAddress = screen->currentCursorPositionColumns + rowOffsets[screen->currentCursorPositionRows];
+			}
+			screen->pendingCursorAddress = LCDSCREEN_STATE_UNKNOWN;
+			lcdScreenDriverInternal_commitDisplayMode(screen);
+		}
+		lcdScreenDriverInternal_writeCommandByte(screen, LCDSCREEN_COMMAND_SET_CGRAM_ADDR | address);
+		lcdScreenDriverInternal_writeByteSequence(screen, pattern, uploadRows, LCDSCREEN_SENDING_MODE_DATA);
+		glyphSlot->uploadPending = 0;
+		uploaded = 1;
+	}
+	if(uploaded){
+		//data writes go to CGRAM until the next DDRAM address, the next data write or commit points it back at the cursor
+		screen->pendingCursorAddress = cursorAddress;
+		if(screen->updateDepth == 0){
+			lcdScreenDriverInternal_commitCursorAddress(screen);
+		}
+	}
+}
+
+uint8_t lcdScreenDriverInternal_ddramLineLength(LcdScreenDriver_Context* screen){
+	return screen->numberOfRows > 1 ? LCDSCREEN_DDRAM_LINE_LENGTH_2LINE : LCDSCREEN_DDRAM_LINE_LENGTH_1LINE;
+}
+
+//Texts up to the line length are padded with blanks, longer ones repeat after their last character
+char lcdScreenDriverInternal_marqueeCharacter(LcdScreenDriver_Context* screen, uint8_t row, uint16_t index){
+	LcdScreenDriver_MarqueeRow* marqueeRow = &screen->marqueeRows[row];
+	if(marqueeRow->text == 0){
+		return ' ';
+	}
+	if(marqueeRow->textLength <= lcdScreenDriverInternal_ddramLineLength(screen)){
+		return index < marqueeRow->textLength ? marqueeRow->text[index] : ' ';
+	}
+	return marqueeRow->text[index % marqueeRow->textLength];
+}
+
+//Writes the whole DDRAM line of a row, starting with the first character at the left edge of the screen
+void lcdScreenDriverInternal_loadMarqueeRow(LcdScreenDriver_Context* screen, uint8_t row){
+	uint8_t rowOffsets[] = {0x00, 0x40};
+	uint8_t lineLength = lcdScreenDriverInternal_ddramLineLength(screen);
+	uint8_t index = 0;
+	while(index < lineLength){
+		//the address counter does not wrap from the end of a line to its start, each stretch gets its own address command
+		uint8_t address = (screen->displayShiftOffset + index) % lineLength;
+		uint8_t stretch = lineLength - address;
+		if(stretch > lineLength - index){
+			stretch = lineLength - index;
+		}
+		lcdScreenDriverInternal_writeCommandByte(screen, LCDSCREEN_COMMAND_SET_DDRAM_ADDR | (rowOffsets[row] + address));
+		while(stretch){
+			uint8_t batch[LCDSCREEN_BATCH_MAX_BYTES];
+			uint8_t bytesInBatch = stretch < LCDSCREEN_BATCH_MAX_BYTES ? stretch : LCDSCREEN_BATCH_MAX_BYTES;
+			for (uint8_t i = 0; i < bytesInBatch; ++i){
+				batch[i] = lcdScreenDriverInternal_marqueeCharacter(screen, row, index + i);
+			}
+			lcdScreenDriverInternal_writeByteSequence(screen, batch, bytesInBatch, LCDSCREEN_SENDING_MODE_DATA);
+			index += bytesInBatch;
+			stretch -= bytesInBatch;
+		}
+	}
+	screen->currentCursorPositionColumns = LCDSCREEN_CURSOR_UNKNOWN;
+}
+
+//Clear and home put the display back unshifted, a running marquee ends with them
+void lcdScreenDriverInternal_resetDisplayShift(LcdScreenDriver_Context* screen){
+	screen->displayShiftOffset = 0;
+	screen->marqueeRunning = 0;
+	for (uint8_t row = 0; row < LCDSCREEN_FRAMEBUFFER_MAX_ROWS; ++row){
+		screen->marqueeRows[row].text = 0;
+	}
+}
+
+void lcdScreenDriverInternal_flushRun(LcdScreenDriver_Context* screen, uint8_t runStart, uint8_t runEnd, uint8_t row){
+	//with a right to left text flow the address counter decrements, so the run is written from its end
+	if(screen->displayModeOptions & (1 << LCDSCREEN_MODE_READ_LEFTTORIGHT_BIT)){
+		if(screen->currentCursorPositionColumns != runStart || screen->currentCursorPositionRows != row){
+			lcdScreenDriver_setCursorPosition(screen, runStart, row);
+		}
+		lcdScreenDriverInternal_writeByteSequence(screen, (uint8_t*) &screen->screenBuffer[row][runStart], runEnd - runStart + 1, LCDSCREEN_SENDING_MODE_DATA);
+		for (uint8_t column = runStart; column <= runEnd; ++column){
+			screen->panelContent[row][column] = screen->screenBuffer[row][column];
+		}
+		screen->currentCursorPositionColumns = runEnd + 1;
+	}
+	else{
+		lcdScreenDriver_setCursorPosition(screen, runEnd, row);
+		for (uint8_t column = runEnd + 1; column-- > runStart;){
+			lcdScreenDriverInternal_writeDataByte(screen, screen->screenBuffer[row][column]);
+			screen->panelContent[row][column] = screen->screenBuffer[row][column];
+		}
+		screen->currentCursorPositionColumns = runStart;
+	}
+}
+
+void lcdScreenDriverInternal_selectDevice(LcdScreenDriver_Context* screen){
+	i2c_setSlaveAddress(screen->deviceAddress);
+	i2c_setSlaveClockSetting(&screen->clockSetting);
+}
+
+void lcdScreenDriverInternal_writeWithCurrentBacklightSetting(LcdScreenDriver_Context* screen, uint8_t dataToWrite){
 	uint8_t errorcode = 0;
-	i2c_setSlaveAddress(deviceAddress);
+	lcdScreenDriverInternal_selectDevice(screen);
 	errorcode = i2c_sendStartCondition();
-	if(errorcode){
-		// printf("error on start condition: %u\n", errorcode);
-		return;
+	if(!errorcode){
+		errorcode = i2c_write(dataToWrite | screen->backlightState);
 	}
-	errorcode =  i2c_write(dataToWrite | backlightState);
 	if(errorcode){
-		// printf("error on write data: %u\n", errorcode);
+		lcdScreenDriverInternal_recordError(screen, errorcode);
 		return;
 	}
 	i2c_sendStopCondition();
+	screen->expanderBacklight = screen->backlightState;
 }
 
-void lcdScreenDriverInternal_writeEnablePulse(uint8_t dataToWrite){
-	lcdScreenDriverInternal_writeWithCurrentBacklightSetting(dataToWrite | LCDSCREEN_PULSE_ENABLE_BIT);
+void lcdScreenDriverInternal_writeEnablePulse(LcdScreenDriver_Context* screen, uint8_t dataToWrite){
+	lcdScreenDriverInternal_writeWithCurrentBacklightSetting(screen, dataToWrite | LCDSCREEN_PULSE_ENABLE_BIT);
 	delayAbstraction_delayMicroseconds(1);
 	
-	lcdScreenDriverInternal_writeWithCurrentBacklightSetting(dataToWrite & ~LCDSCREEN_PULSE_ENABLE_BIT);
-	delayAbstraction_delayMicroseconds(50);
+	lcdScreenDriverInternal_writeWithCurrentBacklightSetting(screen, dataToWrite & ~LCDSCREEN_PULSE_ENABLE_BIT);
+	delayAbstraction_startTimeout(&screen->controllerReady, LCDSCREEN_NIBBLE_DELAY_US);
 }
 
-void lcdScreenDriverInternal_writeNibble(uint8_t fourBitValue, uint8_t sendingMode){
+void lcdScreenDriverInternal_writeNibble(LcdScreenDriver_Context* screen, uint8_t fourBitValue, uint8_t sendingMode){
+	PROFILE_BEGIN(PROFILE_LCD_WRITE_NIBBLE);
+	lcdScreenDriverInternal_waitUntilReady(screen);
 	// printf("writing nibble. Value param %u\n", fourBitValue);
 	fourBitValue = fourBitValue << 4;
 	// printf("writing with backlight settings %u\n", fourBitValue);
-	lcdScreenDriverInternal_writeWithCurrentBacklightSetting(fourBitValue | sendingMode);
+	lcdScreenDriverInternal_writeWithCurrentBacklightSetting(screen, fourBitValue | sendingMode);
 	// printf("writing pulse\n");
-	lcdScreenDriverInternal_writeEnablePulse(fourBitValue | sendingMode);
+	lcdScreenDriverInternal_writeEnablePulse(screen, fourBitValue | sendingMode);
+	PROFILE_END(PROFILE_LCD_WRITE_NIBBLE);
+}
+
+void lcdScreenDriverInternal_writeCommandByte(LcdScreenDriver_Context* screen, uint8_t dataToWrite){
+	lcdScreenDriverInternal_writeByteSequence(screen, &dataToWrite, 1, LCDSCREEN_SENDING_MODE_COMMAND);
+}
+
+void lcdScreenDriverInternal_writeDataByte(LcdScreenDriver_Context* screen, uint8_t dataToWrite){
+	lcdScreenDriverInternal_writeByteSequence(screen, &dataToWrite, 1, LCDSCREEN_SENDING_MODE_DATA);
+}
+
+uint8_t lcdScreenDriverInternal_appendNibble(LcdScreenDriver_Context* screen, uint8_t* expanderSequence, uint8_t position, uint8_t fourBitValue, uint8_t sendingMode){
+	uint8_t expanderByte = (fourBitValue << 4) | sendingMode | screen->backlightState;
+	expanderSequence[position++] = expanderByte;
+	expanderSequence[position++] = expanderByte | LCDSCREEN_PULSE_ENABLE_BIT;
+	expanderSequence[position++] = expanderByte & ~LCDSCREEN_PULSE_ENABLE_BIT;
+	return position;
+}
+
+void lcdScreenDriverInternal_writeExpanderSequence(LcdScreenDriver_Context* screen, uint8_t* expanderSequence, uint8_t length){
+	PROFILE_BEGIN(PROFILE_LCD_EXPANDER_SEQUENCE);
+	uint8_t errorcode = 0;
+	lcdScreenDriverInternal_waitUntilReady(screen);
+	lcdScreenDriverInternal_selectDevice(screen);
+	errorcode = i2c_sendStartCondition();
+	if(!errorcode){
+		errorcode = i2c_writeBytes(expanderSequence, length);
+	}
+	if(errorcode){
+		lcdScreenDriverInternal_recordError(screen, errorcode);
+	}
+	else{
+		i2c_sendStopCondition();
+		screen->expanderBacklight = screen->backlightState;
+	}
+	PROFILE_END(PROFILE_LCD_EXPANDER_SEQUENCE);
+}
+
+/*
+	Reads one nibble of busy flag and address counter: with RW high and the data lines of the expander
+	released (written high) the controller drives D7..D4 while EN is high.
+	In 4-bit mode every read takes two EN pulses, the first one returns the busy flag and AC6..AC4.
+*/
+uint8_t lcdScreenDriverInternal_readNibble(LcdScreenDriver_Context* screen, uint8_t* nibble){
+	uint8_t errorcode = 0;
+	uint8_t expanderSequence[] = {
+		LCDSCREEN_DATA_LINES | LCDSCREEN_READ_WRITE_BIT | screen->backlightState,
+		LCDSCREEN_DATA_LINES | LCDSCREEN_READ_WRITE_BIT | LCDSCREEN_PULSE_ENABLE_BIT | screen->backlightState
+	};
+	uint8_t pins = 0;
+	lcdScreenDriverInternal_selectDevice(screen);
+	errorcode = i2c_sendStartCondition();
+	if(!errorcode){
+		errorcode = i2c_writeBytes(expanderSequence, sizeof(expanderSequence));
+	}
+	if(!errorcode){
+		errorcode = i2c_readBytes(&pins, 1);
+	}
+	if(errorcode){
+		lcdScreenDriverInternal_recordError(screen, errorcode);
+		return errorcode;
+	}
+	i2c_sendStopCondition();
+	*nibble = pins >> 4;
+	return errorcode;
+}
+
+//A failed read counts as busy, the caller then falls back to the deadline
+uint8_t lcdScreenDriverInternal_isBusy(LcdScreenDriver_Context* screen){
+	uint8_t highNibble = 0;
+	uint8_t lowNibble = 0;
+	uint8_t errorcode = lcdScreenDriverInternal_readNibble(screen, &highNibble);
+	if(!errorcode){
+		//the second pulse is needed anyway to keep the controller in step with the nibbles
+		errorcode = lcdScreenDriverInternal_readNibble(screen, &lowNibble);
+	}
+	//end the last pulse while RW is still high, the next write takes RW low
+	lcdScreenDriverInternal_writeWithCurrentBacklightSetting(screen, LCDSCREEN_DATA_LINES | LCDSCREEN_READ_WRITE_BIT);
+	if(errorcode){
+		return 1;
+	}
+	return (highNibble << 4) & LCDSCREEN_BUSY_FLAG;
+}
+
+/*
+	Waits until the controller can take the next transfer.
+	With busy flag polling the deadline of the last command stays the upper bound: backpacks without the RW line
+	wired up, or an expander that does not answer reads, cost no more than the fixed delays.
+*/
+void lcdScreenDriverInternal_waitUntilReady(LcdScreenDriver_Context* screen){
+	if(screen->busyFlagPolling){
+		while(!delayAbstraction_hasExpired(&screen->controllerReady)){
+			if(!lcdScreenDriverInternal_isBusy(screen)){
+				screen->controllerReady.duration = 0;
+				return;
+			}
+		}
+	}
+	delayAbstraction_waitForTimeout(&screen->controllerReady);
+}
+
+/*
+	Sends a run of command or data bytes with one I2C transaction per LCDSCREEN_BATCH_MAX_BYTES bytes
+	instead of six transactions per byte.
+
+	No delays are needed inside a transaction: every expander byte takes nine SCL periods on the bus,
+	so the enable pulse is far longer than the 450ns minimum and the three bytes of the next nibble
+	(about 67us even at 400kHz) cover the 37us execution time of the previous byte.
+	Commands with longer execution times (clear, home) leave a deadline that the next transfer waits for.
+*/
+void lcdScreenDriverInternal_writeByteSequence(LcdScreenDriver_Context* screen, uint8_t* bytesToWrite, uint8_t length, uint8_t sendingMode){
+	uint8_t expanderSequence[LCDSCREEN_BATCH_MAX_BYTES * LCDSCREEN_EXPANDER_BYTES_PER_BYTE];
+	uint8_t failedTransfers = screen->failedTransfers;
+	if(sendingMode == LCDSCREEN_SENDING_MODE_DATA && length && (screen->updateDepth || screen->pendingCursorAddress != LCDSCREEN_STATE_UNKNOWN)){
+		//entry mode and cursor decide where the characters go, an open update cannot hold them back any longer.
+		//After a failed transfer the cursor is pending too, the address counter of the controller is unknown then.
+		uint8_t updateDepth = screen->updateDepth;
+		screen->updateDepth = 0;
+		lcdScreenDriverInternal_commitDisplayMode(screen);
+		lcdScreenDriverInternal_commitCursorAddress(screen);
+		screen->updateDepth = updateDepth;
+	}
+	//after a failure the characters would land at an unknown address, the rest of the run is dropped
+	while(length && screen->failedTransfers == failedTransfers){
+		uint8_t bytesInBatch = length < LCDSCREEN_BATCH_MAX_BYTES ? length : LCDSCREEN_BATCH_MAX_BYTES;
+		uint8_t position = 0;
+		for (uint8_t i = 0; i < bytesInBatch; ++i){
+			position = lcdScreenDriverInternal_appendNibble(screen, expanderSequence, position, bytesToWrite[i] >> 4, sendingMode);
+			position = lcdScreenDriverInternal_appendNibble(screen, expanderSequence, position, bytesToWrite[i] & 0x0F, sendingMode);
+			if(sendingMode == LCDSCREEN_SENDING_MODE_DATA){
+				lcdScreenDriverInternal_trackDataWrite(screen);
+			}
+			else{
+				lcdScreenDriverInternal_trackCommand(screen, bytesToWrite[i]);
+			}
+		}
+		lcdScreenDriverInternal_writeExpanderSequence(screen, expanderSequence, position);
+		bytesToWrite += bytesInBatch;
+		length -= bytesInBatch;
+	}
+}
+
+void lcdScreenDriverInternal_forgetControllerState(LcdScreenDriver_Context* screen){
+	screen->controllerDisplayControl = LCDSCREEN_STATE_UNKNOWN;
+	screen->controllerDisplayMode = LCDSCREEN_STATE_UNKNOWN;
+	screen->controllerAddressCounter = LCDSCREEN_STATE_UNKNOWN;
+	screen->expanderBacklight = LCDSCREEN_STATE_UNKNOWN;
+	screen->pendingCursorAddress = LCDSCREEN_STATE_UNKNOWN;
+}
+
+//A failed transfer may have reached the controller in part, nothing the context assumes about it holds any more
+void lcdScreenDriverInternal_recordError(LcdScreenDriver_Context* screen, uint8_t errorcode){
+	screen->lastError = errorcode;
+	screen->failedTransfers++;
+	//the address the counter should have reached is kept as a cursor move, the next data run sends it first
+	uint8_t pendingCursorAddress = screen->pendingCursorAddress;
+	if(pendingCursorAddress == LCDSCREEN_STATE_UNKNOWN){
+		pendingCursorAddress = screen->controllerAddressCounter;
+	}
+	lcdScreenDriverInternal_forgetControllerState(screen);
+	screen->pendingCursorAddress = pendingCursorAddress;
+	screen->panelContentValid = 0;
+	for (uint8_t slot = 0; slot < LCDSCREEN_GLYPH_SLOTS; ++slot){
+		if(screen->glyphSlots[slot].glyph){
+			screen->glyphSlots[slot].uploadPending = 1;
+		}
+	}
+}
+
+//Follows the effect of every command byte on the state the setters compare against
+void lcdScreenDriverInternal_trackCommand(LcdScreenDriver_Context* screen, uint8_t command){
+	if(command & LCDSCREEN_COMMAND_SET_DDRAM_ADDR){
+		screen->controllerAddressCounter = command & ~LCDSCREEN_COMMAND_SET_DDRAM_ADDR;
+	}
+	else if(command & LCDSCREEN_COMMAND_SET_CGRAM_ADDR){
+		//the counter now points into CGRAM, no DDRAM address matches it
+		screen->controllerAddressCounter = LCDSCREEN_STATE_UNKNOWN;
+	}
+	else if(command & LCDSCREEN_FUNCTIONALITY_COMMAND){
+		return;
+	}
+	else if(command & LCDSCREEN_COMMAND_SHIFT){
+		if(!(command & LCDSCREEN_SHIFT_DISPLAY)){
+			screen->controllerAddressCounter = LCDSCREEN_STATE_UNKNOWN;
+		}
+	}
+	else if(command & LCDSCREEN_COMMAND_SETDISPLAYCONTROL){
+		screen->controllerDisplayControl = command & ~LCDSCREEN_COMMAND_SETDISPLAYCONTROL;
+	}
+	else if(command & LCDSCREEN_COMMAND_SETMODE){
+		screen->controllerDisplayMode = command & ~LCDSCREEN_COMMAND_SETMODE;
+	}
+	else if(command & LCDSCREEN_COMMAND_MOVE_CURSOR_HOME){
+		screen->controllerAddressCounter = 0;
+	}
+	else if(command & LCDSCREEN_COMMAND_CLEAR_DISPLAY){
+		screen->controllerAddressCounter = 0;
+		//clear also sets the entry mode to increment
+		if(screen->controllerDisplayMode != LCDSCREEN_STATE_UNKNOWN){
+			screen->controllerDisplayMode |= (1 << LCDSCREEN_MODE_READ_LEFTTORIGHT_BIT);
+		}
+	}
+}
+
+//A data byte moves the address counter by one in the direction of the entry mode, 0x27 continues at 0x40 in 2-line mode
+void lcdScreenDriverInternal_trackDataWrite(LcdScreenDriver_Context* screen){
+	uint8_t address = screen->controllerAddressCounter;
+	if(address == LCDSCREEN_STATE_UNKNOWN || screen->controllerDisplayMode == LCDSCREEN_STATE_UNKNOWN){
+		screen->controllerAddressCounter = LCDSCREEN_STATE_UNKNOWN;
+		return;
+	}
+	uint8_t increment = screen->controllerDisplayMode & (1 << LCDSCREEN_MODE_READ_LEFTTORIGHT_BIT);
+	if(screen->numberOfRows > 1){
+		if(increment){
+			address = (address == 0x27) ? 0x40 : (address == 0x67) ? 0x00 : address + 1;
+		}
+		else{
+			address = (address == 0x40) ? 0x27 : (address == 0x00) ? 0x67 : address - 1;
+		}
+	}
+	else{
+		address = increment ? (address + 1) % LCDSCREEN_DDRAM_LINE_LENGTH_1LINE : (address + LCDSCREEN_DDRAM_LINE_LENGTH_1LINE - 1) % LCDSCREEN_DDRAM_LINE_LENGTH_1LINE;
+	}
+	screen->controllerAddressCounter = address;
 }
 
-void lcdScreenDriverInternal_writeCommandByte(uint8_t dataToWrite){
-	uint8_t highNibble = dataToWrite >> 4;
-	uint8_t lowNibble = dataToWrite & 0x0F;
-	lcdScreenDriverInternal_writeNibble(highNibble, LCDSCREEN_SENDING_MODE_COMMAND);
-	lcdScreenDriverInternal_writeNibble(lowNibble, LCDSCREEN_SENDING_MODE_COMMAND);
+void lcdScreenDriverInternal_commitDisplayControl(LcdScreenDriver_Context* screen){
+	if(screen->updateDepth == 0 && screen->controllerDisplayControl != screen->displayControlOptions){
+		lcdScreenDriverInternal_writeCommandByte(screen, LCDSCREEN_COMMAND_SETDISPLAYCONTROL | screen->displayControlOptions);
+	}
+}
+
+void lcdScreenDriverInternal_commitDisplayMode(LcdScreenDriver_Context* screen){
+	if(screen->updateDepth == 0 && screen->controllerDisplayMode != screen->displayModeOptions){
+		lcdScreenDriverInternal_writeCommandByte(screen, LCDSCREEN_COMMAND_SETMODE | screen->displayModeOptions);
+	}
 }
 
-void lcdScreenDriverInternal_writeDataByte(uint8_t dataToWrite){
-	uint8_t highNibble = dataToWrite >> 4;
-	uint8_t lowNibble = dataToWrite & 0x0F;
-	lcdScreenDriverInternal_writeNibble(highNibble, LCDSCREEN_SENDING_MODE_DATA);
-	lcdScreenDriverInternal_writeNibble(lowNibble, LCDSCREEN_SENDING_MODE_DATA);
+//Every expander byte carries the backlight bit, a separate write is only needed when nothing else is sent
+void lcdScreenDriverInternal_commitBacklight(LcdScreenDriver_Context* screen){
+	if(screen->updateDepth == 0 && screen->expanderBacklight != screen->backlightState){
+		lcdScreenDriverInternal_writeWithCurrentBacklightSetting(screen, 0);
+	}
+}
+
+//Auto-increment often leaves the address counter where the cursor is meant to go, the address command is then left out
+void lcdScreenDriverInternal_commitCursorAddress(LcdScreenDriver_Context* screen){
+	uint8_t address = screen->pendingCursorAddress;
+	if(screen->updateDepth || address == LCDSCREEN_STATE_UNKNOWN){
+		return;
+	}
+	screen->pendingCursorAddress = LCDSCREEN_STATE_UNKNOWN;
+	if(screen->controllerAddressCounter != address){
+		lcdScreenDriverInternal_writeCommandByte(screen, LCDSCREEN_COMMAND_SET_DDRAM_ADDR | address);
+	}
 }
 
 /*
@@ -3,9 +3,11 @@
 
 #include <stdint.h>
 #include "i2cInterface.h"
+#include "delayAbstraction.h"
 
 #define LCDSCREEN_ERRORCODE_ALL_OK 0x00
 #define LCDSCREEN_ERRORCODE_INVALIDPARAMS 0x01
+#define LCDSCREEN_ERRORCODE_NO_GLYPH_SLOT 0x02
 
 
 #define LCDSCREEN_TYPE_5x8DOTS 0x00
@@ -22,24 +24,197 @@
 #define LCDSCREEN_MODE_READ_LEFTTORIGHT_BIT 1 //if bit set to one it is left to right, set to zero it is right to left
 #define LCDSCREEN_MODE_SHIFTINCREMENT_BIT 0 //if set to 1 it is Increment, if set to zero it is decrement
 
-uint8_t lcdScreenDriver_initialise(I2C_Registers* registers, uint8_t lcdScreenI2CAddress, uint8_t charactersPerRow, uint8_t numberOfRows, uint8_t screenType);
-void lcdScreenDriver_initialiseScreenToKnownState(void);
-void lcdScreenDriver_setDisplayControlOptions(uint8_t controlOptions);
-void lcdScreenDriver_setDisplayMode(uint8_t modeOptions);
-void lcdScreenDriver_setScreenFunctionOptions(uint8_t functionOptions);
-void lcdScreenDriver_setBacklightOn(void);
-void lcdScreenDriver_setBacklightOff(void);
-void lcdScreenDriver_turnDisplayOn(void);
-void lcdScreenDriver_turnDisplayOff(void);
-void lcdScreenDriver_setCursorPosition(uint8_t cursorPositionColumn, uint8_t cursorPositionRow);
-void lcdScreenDriver_setCursorOff(void);
-void lcdScreenDriver_setCursorOn(void);
-void lcdScreenDriver_setBlinkOff(void);
-void lcdScreenDriver_setBlinkOn(void);
-void lcdScreenDriver_setTextFlow(uint8_t textFlowDirection);
-void lcdScreenDriver_clearDisplay(void);
-void lcdScreenDriver_setCursorHome(void);
-void lcdScreenDriver_printChar(char c);
-void lcdScreenDriver_printString(char* string);
+//Bus speed of the backpack. The PCF8574 is specified up to 100kHz, most backpacks also run at 400kHz
+#ifndef LCDSCREEN_I2C_CLOCK
+#define LCDSCREEN_I2C_CLOCK 100000L
+#endif
+
+//Size of the RAM shadow of the visible screen, the largest supported panel
+#ifndef LCDSCREEN_FRAMEBUFFER_MAX_COLUMNS
+#define LCDSCREEN_FRAMEBUFFER_MAX_COLUMNS 20
+#endif
+#ifndef LCDSCREEN_FRAMEBUFFER_MAX_ROWS
+#define LCDSCREEN_FRAMEBUFFER_MAX_ROWS 2
+#endif
+
+//CGRAM has eight character slots with the 5x8 font and four with the 5x10 font
+#define LCDSCREEN_GLYPH_SLOTS 8
+#define LCDSCREEN_GLYPH_SLOTS_5x10 4
+#define LCDSCREEN_GLYPH_ROWS_5x8 8
+#define LCDSCREEN_GLYPH_ROWS_5x10 10
+
+#define LCDSCREEN_STATE_UNKNOWN 0xFF
+
+//Written to a context once its controller is configured, a context in MEMORYABSTRACTION_NOINIT memory still holds it after a reset
+#define LCDSCREEN_WARM_SIGNATURE 0x4C43
+
+//DDRAM line length of the HD44780: 40 characters per line in 2-line mode, the full 80 in 1-line mode
+#define LCDSCREEN_DDRAM_LINE_LENGTH_2LINE 40
+#define LCDSCREEN_DDRAM_LINE_LENGTH_1LINE 80
+
+typedef struct{
+	const char* text; //0 when the row takes no part in the marquee, it then shows blanks
+	uint16_t textLength;
+	uint16_t textPosition; //index of the character at the left edge of the screen, only followed for texts longer than the DDRAM line
+}LcdScreenDriver_MarqueeRow;
+
+typedef struct{
+	const uint8_t* glyph; //bitmap in flash the slot holds, 0 when free
+	uint16_t lastUse;
+	uint8_t uploadPending; //CGRAM still holds the previous glyph, the next flush or printGlyph sends it
+}LcdScreenDriver_GlyphSlot;
+
+//State of one display. Every backpack on the bus gets its own context, the driver keeps no globals,
+//so any number of displays at different addresses (0x20-0x27 for the PCF8574, 0x38-0x3F for the PCF8574A)
+//can share one bus.
+typedef struct{
+	uint16_t warmSignature;
+	uint8_t warmStartAvailable; //lcdScreenDriver_initialise found the signature of a configured controller with the same geometry
+	uint8_t deviceAddress;
+	I2C_ClockSetting clockSetting; //bus speed of the backpack, switched in before every transfer to it
+	uint8_t displayControlOptions;
+	uint8_t displayModeOptions;
+	uint8_t numberOfRows;
+	uint8_t numberOfColumns;
+	uint8_t characterType;
+	uint8_t backlightState;
+	uint8_t currentCursorPositionColumns;
+	uint8_t currentCursorPositionRows;
+	//Shadow copies of the visible DDRAM cells.
+	//screenBuffer holds what the application wants to see, panelContent what the panel currently shows.
+	//lcdScreenDriver_flush only sends the cells where the two differ.
+	char screenBuffer[LCDSCREEN_FRAMEBUFFER_MAX_ROWS][LCDSCREEN_FRAMEBUFFER_MAX_COLUMNS];
+	char panelContent[LCDSCREEN_FRAMEBUFFER_MAX_ROWS][LCDSCREEN_FRAMEBUFFER_MAX_COLUMNS];
+	uint8_t panelContentValid;
+	//Commands with long execution times (clear, home) set this deadline instead of waiting,
+	//the next transfer to the controller waits for whatever is left of it
+	DelayAbstraction_Timeout controllerReady;
+	//When set, a wait for the controller ends as soon as the busy flag reads clear instead of running out the deadline
+	uint8_t busyFlagPolling;
+	LcdScreenDriver_GlyphSlot glyphSlots[LCDSCREEN_GLYPH_SLOTS];
+	uint16_t glyphUseCounter;
+	//Display shift of the controller in DDRAM columns, only the marquee moves it
+	uint8_t displayShiftOffset;
+	uint8_t marqueeRunning;
+	uint32_t marqueeStepMicros;
+	DelayAbstraction_Timeout marqueeStep;
+	LcdScreenDriver_MarqueeRow marqueeRows[LCDSCREEN_FRAMEBUFFER_MAX_ROWS];
+	//What the controller and the expander were last sent, LCDSCREEN_STATE_UNKNOWN until a transfer sets it.
+	//Setters compare against these and drop commands that would not change anything.
+	uint8_t controllerDisplayControl;
+	uint8_t controllerDisplayMode;
+	uint8_t controllerAddressCounter;
+	uint8_t expanderBacklight;
+	uint8_t pendingCursorAddress; //set by a cursor move that is not sent yet, LCDSCREEN_STATE_UNKNOWN when none
+	uint8_t updateDepth; //open lcdScreenDriver_beginUpdate calls
+	uint8_t lastError; //I2C_CODES_* of the last failed transfer, I2C_CODES_NO_ERROR when none
+	uint8_t failedTransfers; //counts up with every failed transfer, wraps around
+}LcdScreenDriver_Context;
+
+uint8_t lcdScreenDriver_initialise(LcdScreenDriver_Context* screen, I2C_Registers* registers, uint8_t lcdScreenI2CAddress, uint8_t charactersPerRow, uint8_t numberOfRows, uint8_t screenType);
+void lcdScreenDriver_initialiseScreenToKnownState(LcdScreenDriver_Context* screen);
+/*
+	Warm start after an MCU reset that left the display powered, for example by the watchdog.
+	The context has to be in MEMORYABSTRACTION_NOINIT memory so lcdScreenDriver_initialise finds the signature
+	of the last configuration. powerWasLost is set when the reset cause (PORF or BORF in MCUSR) means the display
+	restarted too, the full sequence then runs. Otherwise the interface is brought back into nibble step,
+	the configuration is sent again and the display keeps showing its content, there is no clear.
+	The next flush redraws every cell. Returns 1 when the warm path was taken.
+*/
+uint8_t lcdScreenDriver_initialiseScreenWarm(LcdScreenDriver_Context* screen, uint8_t powerWasLost);
+void lcdScreenDriver_setDisplayControlOptions(LcdScreenDriver_Context* screen, uint8_t controlOptions);
+void lcdScreenDriver_setDisplayMode(LcdScreenDriver_Context* screen, uint8_t modeOptions);
+void lcdScreenDriver_setScreenFunctionOptions(LcdScreenDriver_Context* screen, uint8_t functionOptions);
+void lcdScreenDriver_setBacklightOn(LcdScreenDriver_Context* screen);
+void lcdScreenDriver_setBacklightOff(LcdScreenDriver_Context* screen);
+void lcdScreenDriver_turnDisplayOn(LcdScreenDriver_Context* screen);
+void lcdScreenDriver_turnDisplayOff(LcdScreenDriver_Context* screen);
+void lcdScreenDriver_setCursorPosition(LcdScreenDriver_Context* screen, uint8_t cursorPositionColumn, uint8_t cursorPositionRow);
+void lcdScreenDriver_setCursorOff(LcdScreenDriver_Context* screen);
+void lcdScreenDriver_setCursorOn(LcdScreenDriver_Context* screen);
+void lcdScreenDriver_setBlinkOff(LcdScreenDriver_Context* screen);
+void lcdScreenDriver_setBlinkOn(LcdScreenDriver_Context* screen);
+void lcdScreenDriver_setTextFlow(LcdScreenDriver_Context* screen, uint8_t textFlowDirection);
+void lcdScreenDriver_clearDisplay(LcdScreenDriver_Context* screen);
+void lcdScreenDriver_setCursorHome(LcdScreenDriver_Context* screen);
+void lcdScreenDriver_printChar(LcdScreenDriver_Context* screen, char c);
+/*
+	Batched state changes. Between beginUpdate and commitUpdate display control, entry mode, backlight and cursor
+	moves only change the context, commitUpdate sends the final state with at most one command each.
+	Entry mode and cursor position are sent earlier when characters are written in between, they decide where
+	the characters go. Calls nest, the outermost commitUpdate sends.
+*/
+void lcdScreenDriver_beginUpdate(LcdScreenDriver_Context* screen);
+void lcdScreenDriver_commitUpdate(LcdScreenDriver_Context* screen);
+void lcdScreenDriver_printString(LcdScreenDriver_Context* screen, char* string);
+uint8_t lcdScreenDriver_isReady(LcdScreenDriver_Context* screen);
+/*
+	Returns the I2C_CODES_* value of the last transfer to the display that failed and clears it.
+	A failed transfer leaves the controller state unknown: the next setter calls send their commands again,
+	glyphs are uploaded again and the next flush redraws every cell. A transfer that broke off between the two
+	nibbles of a byte leaves the interface out of step, lcdScreenDriver_initialiseScreenWarm(screen, 0) brings it back.
+*/
+uint8_t lcdScreenDriver_getLastError(LcdScreenDriver_Context* screen);
+//Read the busy flag over the RW line instead of waiting out the worst case execution times, off by default.
+//Needs a backpack with RW wired to the expander, without it every wait still ends at the fixed delay.
+void lcdScreenDriver_setBusyFlagPolling(LcdScreenDriver_Context* screen, uint8_t enabled);
+//Changes the bus speed used for the display only, other devices on the bus keep theirs.
+//actualClockspeed may be 0, otherwise it receives the rate the TWI really runs at.
+uint8_t lcdScreenDriver_setI2CClock(LcdScreenDriver_Context* screen, uint32_t clockspeed, uint32_t* actualClockspeed);
+
+//Framebuffer functions only change the RAM shadow of the screen.
+//lcdScreenDriver_flush sends the cells that differ from what the panel shows, one address command per changed run.
+void lcdScreenDriver_bufferClear(LcdScreenDriver_Context* screen);
+void lcdScreenDriver_bufferSetChar(LcdScreenDriver_Context* screen, uint8_t column, uint8_t row, char c);
+void lcdScreenDriver_bufferPrintString(LcdScreenDriver_Context* screen, uint8_t column, uint8_t row, char* string);
+void lcdScreenDriver_flush(LcdScreenDriver_Context* screen);
+
+/*
+	Custom characters. A glyph is the address of its bitmap in flash (MEMORYABSTRACTION_PROGMEM in memoryAbstraction.h),
+	one byte per pixel row with the lower five bits used, 8 rows for the 5x8 font and 10 rows for the 5x10 font.
+	Glyphs need no registration, any number of them can be used as long as no more than the CGRAM slots are on the
+	screen at once. A glyph already in CGRAM is not sent again. A new glyph takes a free slot or the least recently
+	used slot whose glyph is no longer in the framebuffer, otherwise LCDSCREEN_ERRORCODE_NO_GLYPH_SLOT is returned.
+*/
+uint8_t lcdScreenDriver_bufferSetGlyph(LcdScreenDriver_Context* screen, uint8_t column, uint8_t row, const uint8_t* glyph);
+uint8_t lcdScreenDriver_printGlyph(LcdScreenDriver_Context* screen, const uint8_t* glyph);
+
+//Flushes several displays in one pass: the ones that are ready first, then the ones still busy with a clear or home,
+//so no display waits for another one.
+void lcdScreenDriver_flushAll(LcdScreenDriver_Context** screens, uint8_t numberOfScreens);
+
+/*
+	Flash strings and numbers, none of them copies its text to RAM first. _P functions take strings in flash
+	(MEMORYABSTRACTION_FLASH_STRING or MEMORYABSTRACTION_PROGMEM), the print functions write at the cursor,
+	the bufferPrint functions into the framebuffer like lcdScreenDriver_bufferPrintString.
+	Numbers are right aligned in width cells, a wider number takes the space it needs. A fixed point value is
+	an integer scaled by 10^fractionDigits: 2156 with two fraction digits is shown as 21.56.
+	The format functions understand %d %u %x %c, with an l for 32-bit values, %s for a string in RAM, %S for
+	a string in flash and %%. Numbers take a width with an optional leading 0 for zero padding, and %d a
+	precision for fixed point: "%5.1d" shows 215 as " 21.5".
+*/
+void lcdScreenDriver_printString_P(LcdScreenDriver_Context* screen, const char* string);
+void lcdScreenDriver_bufferPrintString_P(LcdScreenDriver_Context* screen, uint8_t column, uint8_t row, const char* string);
+void lcdScreenDriver_printInteger(LcdScreenDriver_Context* screen, int32_t value, uint8_t width);
+void lcdScreenDriver_bufferPrintInteger(LcdScreenDriver_Context* screen, uint8_t column, uint8_t row, int32_t value, uint8_t width);
+void lcdScreenDriver_printFixedPoint(LcdScreenDriver_Context* screen, int32_t value, uint8_t fractionDigits, uint8_t width);
+void lcdScreenDriver_bufferPrintFixedPoint(LcdScreenDriver_Context* screen, uint8_t column, uint8_t row, int32_t value, uint8_t fractionDigits, uint8_t width);
+void lcdScreenDriver_printFormat_P(LcdScreenDriver_Context* screen, const char* format, ...);
+void lcdScreenDriver_bufferPrintFormat_P(LcdScreenDriver_Context* screen, uint8_t column, uint8_t row, const char* format, ...);
+
+/*
+	Marquee. The text of a row is written to its whole DDRAM line once, each step then moves the display
+	with a single shift command. Texts up to the line length are padded with blanks and repeat without further writes,
+	longer texts refill the column that is about to come into view, one address command and one data byte per step.
+	The shift moves every line of the display, rows without marquee text scroll whatever their DDRAM line holds. While the marquee runs
+	the framebuffer is not flushed, lcdScreenDriver_stopMarquee returns the display to its unshifted state and
+	the next flush redraws the framebuffer. The text must stay in place while the marquee uses it and the text flow
+	must be left to right.
+*/
+uint8_t lcdScreenDriver_setMarqueeText(LcdScreenDriver_Context* screen, uint8_t row, const char* text);
+void lcdScreenDriver_startMarquee(LcdScreenDriver_Context* screen, uint32_t stepPeriodMicros);
+//Call from the main loop or a scheduler task, returns 1 when the display moved one step
+uint8_t lcdScreenDriver_serviceMarquee(LcdScreenDriver_Context* screen);
+void lcdScreenDriver_stopMarquee(LcdScreenDriver_Context* screen);
 
 #endif // _LCDSCREENDRIVER_H
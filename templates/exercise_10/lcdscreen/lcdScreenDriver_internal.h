@@ -2,11 +2,16 @@
 #define _LCDSCREENDRIVER_INTERNAL_H
 
 #include <stdint.h>
+#include <stdarg.h>
+#include "lcdScreenDriver.h"
 
 #define LCDSCREEN_INTERFACE_4BITMODE_A 0x03
 #define LCDSCREEN_INTERFACE_4BITMODE_B 0x02
 #define LCDSCREEN_INTERFACE_4BITMODE_DELAY_LONG_US 4500
 #define LCDSCREEN_INTERFACE_4BITMODE_DELAY_SHORT_US 150
+#define LCDSCREEN_CLEAR_HOME_DELAY_US 2000
+#define LCDSCREEN_NIBBLE_DELAY_US 50
+#define LCDSCREEN_RESYNC_DELAY_US 150
 
 #define LCDSCREEN_FUNCTIONALITY_COMMAND 0x20
 #define LCDSCREEN_FUNCTIONALITY_4BITMODE 0x00
@@ -17,9 +22,19 @@
 #define LCDSCREEN_FUNCTIONALITY_RESOLUTION_5X10DOTS 0x04
 
 #define LCDSCREEN_PULSE_ENABLE_BIT 0x04
+#define LCDSCREEN_READ_WRITE_BIT 0x02
+#define LCDSCREEN_DATA_LINES 0xF0
+#define LCDSCREEN_BUSY_FLAG 0x80
 #define LCDSCREEN_INTERNAL_BACKLIGHT_ON 0x08
 #define LCDSCREEN_INTERNAL_BACKLIGHT_OFF 0x00
 
+#define LCDSCREEN_EXPANDER_BYTES_PER_BYTE 6 //two nibbles of setup, enable high, enable low
+
+//Command or data bytes sent in one I2C transaction, sets the size of the expander sequence buffer on the stack
+#ifndef LCDSCREEN_BATCH_MAX_BYTES
+#define LCDSCREEN_BATCH_MAX_BYTES 8
+#endif
+
 #define LCDSCREEN_SENDING_MODE_DATA 1 //reaching for the very low hanging fruits
 #define LCDSCREEN_SENDING_MODE_COMMAND 0
 
@@ -27,13 +42,73 @@
 #define LCDSCREEN_COMMAND_MOVE_CURSOR_HOME 0x02
 #define LCDSCREEN_COMMAND_SETMODE 0x04
 #define LCDSCREEN_COMMAND_SETDISPLAYCONTROL 0x08
+#define LCDSCREEN_COMMAND_SHIFT 0x10
+#define LCDSCREEN_SHIFT_DISPLAY 0x08 //without it the command only moves the cursor
+#define LCDSCREEN_SHIFT_RIGHT 0x04
 
+#define LCDSCREEN_COMMAND_SET_CGRAM_ADDR 0x40
 #define LCDSCREEN_COMMAND_SET_DDRAM_ADDR 0x80
+#define LCDSCREEN_GLYPH_ROW_MASK 0x1F
+#define LCDSCREEN_GLYPH_NO_SLOT 0xFF
+#define LCDSCREEN_CURSOR_UNKNOWN 0xFF //the address counter was left outside the visible cells, the next write sets it
+
+//Clean cells between two changed cells that a flush still resends instead of starting a new run.
+//Each resent cell costs one data byte, a new run costs one address command byte.
+#define LCDSCREEN_FLUSH_MAX_CLEAN_GAP 1
+
+#define LCDSCREEN_MAX_DECIMAL_DIGITS 10 //4294967295
+
+//Where the text renderers put their characters: the framebuffer at column and row, or the display at the cursor.
+//Direct output is collected in a few bytes so a number still goes out in one transfer.
+typedef struct{
+	LcdScreenDriver_Context* screen;
+	uint8_t toBuffer;
+	uint8_t column;
+	uint8_t row;
+	uint8_t length;
+	char pending[LCDSCREEN_BATCH_MAX_BYTES + 1];
+}LcdScreenDriver_Writer;
 
-void lcdScreenDriverInternal_writeWithCurrentBacklightSetting(uint8_t dataToWrite);
-void lcdScreenDriverInternal_writeEnablePulse(uint8_t dataToWrite);
-void lcdScreenDriverInternal_writeNibble(uint8_t fourBitValue, uint8_t sendingMode);
-void lcdScreenDriverInternal_writeCommandByte(uint8_t dataToWrite);
-void lcdScreenDriverInternal_writeDataByte(uint8_t dataToWrite);
+void lcdScreenDriverInternal_selectDevice(LcdScreenDriver_Context* screen);
+void lcdScreenDriverInternal_writeWithCurrentBacklightSetting(LcdScreenDriver_Context* screen, uint8_t dataToWrite);
+void lcdScreenDriverInternal_writeEnablePulse(LcdScreenDriver_Context* screen, uint8_t dataToWrite);
+void lcdScreenDriverInternal_writeNibble(LcdScreenDriver_Context* screen, uint8_t fourBitValue, uint8_t sendingMode);
+void lcdScreenDriverInternal_writeCommandByte(LcdScreenDriver_Context* screen, uint8_t dataToWrite);
+void lcdScreenDriverInternal_writeDataByte(LcdScreenDriver_Context* screen, uint8_t dataToWrite);
+uint8_t lcdScreenDriverInternal_appendNibble(LcdScreenDriver_Context* screen, uint8_t* expanderSequence, uint8_t position, uint8_t fourBitValue, uint8_t sendingMode);
+void lcdScreenDriverInternal_writeExpanderSequence(LcdScreenDriver_Context* screen, uint8_t* expanderSequence, uint8_t length);
+uint8_t lcdScreenDriverInternal_readNibble(LcdScreenDriver_Context* screen, uint8_t* nibble);
+uint8_t lcdScreenDriverInternal_isBusy(LcdScreenDriver_Context* screen);
+void lcdScreenDriverInternal_waitUntilReady(LcdScreenDriver_Context* screen);
+void lcdScreenDriverInternal_writeByteSequence(LcdScreenDriver_Context* screen, uint8_t* bytesToWrite, uint8_t length, uint8_t sendingMode);
+void lcdScreenDriverInternal_fillShadow(char shadow[LCDSCREEN_FRAMEBUFFER_MAX_ROWS][LCDSCREEN_FRAMEBUFFER_MAX_COLUMNS], char c);
+uint8_t lcdScreenDriverInternal_isCellDirty(LcdScreenDriver_Context* screen, uint8_t column, uint8_t row);
+uint8_t lcdScreenDriverInternal_usesTallFont(LcdScreenDriver_Context* screen);
+uint8_t lcdScreenDriverInternal_glyphCharacterCode(LcdScreenDriver_Context* screen, uint8_t slot);
+uint8_t lcdScreenDriverInternal_isGlyphInBuffer(LcdScreenDriver_Context* screen, uint8_t slot);
+uint8_t lcdScreenDriverInternal_acquireGlyphSlot(LcdScreenDriver_Context* screen, const uint8_t* glyph, uint8_t* slot);
+void lcdScreenDriverInternal_uploadPendingGlyphs(LcdScreenDriver_Context* screen);
+uint8_t lcdScreenDriverInternal_ddramLineLength(LcdScreenDriver_Context* screen);
+char lcdScreenDriverInternal_marqueeCharacter(LcdScreenDriver_Context* screen, uint8_t row, uint16_t index);
+void lcdScreenDriverInternal_loadMarqueeRow(LcdScreenDriver_Context* screen, uint8_t row);
+void lcdScreenDriverInternal_resetDisplayShift(LcdScreenDriver_Context* screen);
+void lcdScreenDriverInternal_configureController(LcdScreenDriver_Context* screen);
+void lcdScreenDriverInternal_forgetControllerState(LcdScreenDriver_Context* screen);
+void lcdScreenDriverInternal_recordError(LcdScreenDriver_Context* screen, uint8_t errorcode);
+void lcdScreenDriverInternal_trackCommand(LcdScreenDriver_Context* screen, uint8_t command);
+void lcdScreenDriverInternal_trackDataWrite(LcdScreenDriver_Context* screen);
+void lcdScreenDriverInternal_commitDisplayControl(LcdScreenDriver_Context* screen);
+void lcdScreenDriverInternal_commitDisplayMode(LcdScreenDriver_Context* screen);
+void lcdScreenDriverInternal_commitBacklight(LcdScreenDriver_Context* screen);
+void lcdScreenDriverInternal_commitCursorAddress(LcdScreenDriver_Context* screen);
+void lcdScreenDriverInternal_startWriter(LcdScreenDriver_Writer* writer, LcdScreenDriver_Context* screen, uint8_t toBuffer, uint8_t column, uint8_t row);
+void lcdScreenDriverInternal_emit(LcdScreenDriver_Writer* writer, char c);
+void lcdScreenDriverInternal_finishWriter(LcdScreenDriver_Writer* writer);
+void lcdScreenDriverInternal_emitFlashString(LcdScreenDriver_Writer* writer, const char* string);
+void lcdScreenDriverInternal_renderDecimal(LcdScreenDriver_Writer* writer, uint32_t magnitude, uint8_t negative, uint8_t fractionDigits, uint8_t width, char padding);
+void lcdScreenDriverInternal_renderHex(LcdScreenDriver_Writer* writer, uint32_t value, uint8_t width, char padding);
+void lcdScreenDriverInternal_renderSigned(LcdScreenDriver_Writer* writer, int32_t value, uint8_t fractionDigits, uint8_t width, char padding);
+void lcdScreenDriverInternal_format(LcdScreenDriver_Writer* writer, const char* format, va_list arguments);
+void lcdScreenDriverInternal_flushRun(LcdScreenDriver_Context* screen, uint8_t runStart, uint8_t runEnd, uint8_t row);
 
 #endif //_LCDSCREENDRIVER_INTERNAL_H
\ No newline at end of file
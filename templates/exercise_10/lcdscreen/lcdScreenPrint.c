@@ -0,0 +1,239 @@
+#include <stdarg.h>
+
+#include "lcdScreenDriver.h"
+#include "lcdScreenDriver_internal.h"
+#include "memoryAbstraction.h"
+
+//Text output from flash strings, numbers and format strings. Digits are produced one at a time by subtracting
+//powers of ten, the AVR has no divide instruction and no digit string is built.
+
+const uint32_t lcdScreenPrintPowersOfTen[LCDSCREEN_MAX_DECIMAL_DIGITS] MEMORYABSTRACTION_PROGMEM = {
+	1UL, 10UL, 100UL, 1000UL, 10000UL, 100000UL, 1000000UL, 10000000UL, 100000000UL, 1000000000UL
+};
+
+void lcdScreenDriver_printString_P(LcdScreenDriver_Context* screen, const char* string){
+	LcdScreenDriver_Writer writer;
+	lcdScreenDriverInternal_startWriter(&writer, screen, 0, 0, 0);
+	lcdScreenDriverInternal_emitFlashString(&writer, string);
+	lcdScreenDriverInternal_finishWriter(&writer);
+}
+
+void lcdScreenDriver_bufferPrintString_P(LcdScreenDriver_Context* screen, uint8_t column, uint8_t row, const char* string){
+	LcdScreenDriver_Writer writer;
+	lcdScreenDriverInternal_startWriter(&writer, screen, 1, column, row);
+	lcdScreenDriverInternal_emitFlashString(&writer, string);
+}
+
+void lcdScreenDriver_printInteger(LcdScreenDriver_Context* screen, int32_t value, uint8_t width){
+	lcdScreenDriver_printFixedPoint(screen, value, 0, width);
+}
+
+void lcdScreenDriver_bufferPrintInteger(LcdScreenDriver_Context* screen, uint8_t column, uint8_t row, int32_t value, uint8_t width){
+	lcdScreenDriver_bufferPrintFixedPoint(screen, column, row, value, 0, width);
+}
+
+void lcdScreenDriver_printFixedPoint(LcdScreenDriver_Context* screen, int32_t value, uint8_t fractionDigits, uint8_t width){
+	LcdScreenDriver_Writer writer;
+	lcdScreenDriverInternal_startWriter(&writer, screen, 0, 0, 0);
+	lcdScreenDriverInternal_renderSigned(&writer, value, fractionDigits, width, ' ');
+	lcdScreenDriverInternal_finishWriter(&writer);
+}
+
+void lcdScreenDriver_bufferPrintFixedPoint(LcdScreenDriver_Context* screen, uint8_t column, uint8_t row, int32_t value, uint8_t fractionDigits, uint8_t width){
+	LcdScreenDriver_Writer writer;
+	lcdScreenDriverInternal_startWriter(&writer, screen, 1, column, row);
+	lcdScreenDriverInternal_renderSigned(&writer, value, fractionDigits, width, ' ');
+}
+
+void lcdScreenDriver_printFormat_P(LcdScreenDriver_Context* screen, const char* format, ...){
+	LcdScreenDriver_Writer writer;
+	va_list arguments;
+	lcdScreenDriverInternal_startWriter(&writer, screen, 0, 0, 0);
+	va_start(arguments, format);
+	lcdScreenDriverInternal_format(&writer, format, arguments);
+	va_end(arguments);
+	lcdScreenDriverInternal_finishWriter(&writer);
+}
+
+void lcdScreenDriver_bufferPrintFormat_P(LcdScreenDriver_Context* screen, uint8_t column, uint8_t row, const char* format, ...){
+	LcdScreenDriver_Writer writer;
+	va_list arguments;
+	lcdScreenDriverInternal_startWriter(&writer, screen, 1, column, row);
+	va_start(arguments, format);
+	lcdScreenDriverInternal_format(&writer, format, arguments);
+	va_end(arguments);
+}
+
+//##################################
+//Internal applications
+void lcdScreenDriverInternal_startWriter(LcdScreenDriver_Writer* writer, LcdScreenDriver_Context* screen, uint8_t toBuffer, uint8_t column, uint8_t row){
+	writer->screen = screen;
+	writer->toBuffer = toBuffer;
+	writer->column = column;
+	writer->row = row;
+	writer->length = 0;
+}
+
+//Framebuffer output follows the line breaks and wrapping of lcdScreenDriver_bufferPrintString
+void lcdScreenDriverInternal_emit(LcdScreenDriver_Writer* writer, char c){
+	LcdScreenDriver_Context* screen = writer->screen;
+	if(!writer->toBuffer){
+		writer->pending[writer->length++] = c;
+		if(writer->length == LCDSCREEN_BATCH_MAX_BYTES){
+			lcdScreenDriverInternal_finishWriter(writer);
+		}
+		return;
+	}
+	if(c == '\n'){
+		writer->column = 0;
+		writer->row++;
+		return;
+	}
+	if(writer->column >= screen->numberOfColumns){
+		writer->column = 0;
+		writer->row++;
+	}
+	if(writer->row >= screen->numberOfRows){
+		return;
+	}
+	screen->screenBuffer[writer->row][writer->column++] = c;
+}
+
+//Sends what direct output collected so far, printString takes care of line breaks and the shadow copies
+void lcdScreenDriverInternal_finishWriter(LcdScreenDriver_Writer* writer){
+	if(writer->toBuffer || writer->length == 0){
+		return;
+	}
+	writer->pending[writer->length] = '\0';
+	lcdScreenDriver_printString(writer->screen, writer->pending);
+	writer->length = 0;
+}
+
+void lcdScreenDriverInternal_emitFlashString(LcdScreenDriver_Writer* writer, const char* string){
+	char c;
+	while((c = memoryAbstraction_readFlashByte(string++))){
+		lcdScreenDriverInternal_emit(writer, c);
+	}
+}
+
+void lcdScreenDriverInternal_renderDecimal(LcdScreenDriver_Writer* writer, uint32_t magnitude, uint8_t negative, uint8_t fractionDigits, uint8_t width, char padding){
+	if(fractionDigits >= LCDSCREEN_MAX_DECIMAL_DIGITS){
+		fractionDigits = LCDSCREEN_MAX_DECIMAL_DIGITS - 1;
+	}
+	uint8_t digits = 1;
+	while(digits < LCDSCREEN_MAX_DECIMAL_DIGITS && magnitude >= memoryAbstraction_readFlashDword(&lcdScreenPrintPowersOfTen[digits])){
+		digits++;
+	}
+	//a fixed point value below one still shows the zero in front of the point
+	if(digits <= fractionDigits){
+		digits = fractionDigits + 1;
+	}
+	uint8_t length = digits + (negative ? 1 : 0) + (fractionDigits ? 1 : 0);
+	//the sign goes in front of zero padding and behind blank padding
+	if(negative && padding == '0'){
+		lcdScreenDriverInternal_emit(writer, '-');
+	}
+	for (; length < width; ++length){
+		lcdScreenDriverInternal_emit(writer, padding);
+	}
+	if(negative && padding != '0'){
+		lcdScreenDriverInternal_emit(writer, '-');
+	}
+	while(digits--){
+		uint32_t powerOfTen = memoryAbstraction_readFlashDword(&lcdScreenPrintPowersOfTen[digits]);
+		char digit = '0';
+		while(magnitude >= powerOfTen){
+			magnitude -= powerOfTen;
+			digit++;
+		}
+		lcdScreenDriverInternal_emit(writer, digit);
+		if(fractionDigits && digits == fractionDigits){
+			lcdScreenDriverInternal_emit(writer, '.');
+		}
+	}
+}
+
+void lcdScreenDriverInternal_renderHex(LcdScreenDriver_Writer* writer, uint32_t value, uint8_t width, char padding){
+	uint8_t digits = 1;
+	while(digits < 8 && (value >> (digits * 4))){
+		digits++;
+	}
+	for (uint8_t length = digits; length < width; ++length){
+		lcdScreenDriverInternal_emit(writer, padding);
+	}
+	while(digits--){
+		uint8_t nibble = (value >> (digits * 4)) & 0x0F;
+		lcdScreenDriverInternal_emit(writer, nibble < 10 ? '0' + nibble : 'a' + nibble - 10);
+	}
+}
+
+void lcdScreenDriverInternal_renderSigned(LcdScreenDriver_Writer* writer, int32_t value, uint8_t fractionDigits, uint8_t width, char padding){
+	//negating in unsigned arithmetic also covers the smallest int32_t
+	uint32_t magnitude = value < 0 ? -(uint32_t)value : (uint32_t)value;
+	lcdScreenDriverInternal_renderDecimal(writer, magnitude, value < 0, fractionDigits, width, padding);
+}
+
+//The conversions of avr-libc's printf that a display needs, the format string is read from flash
+void lcdScreenDriverInternal_format(LcdScreenDriver_Writer* writer, const char* format, va_list arguments){
+	char c;
+	while((c = memoryAbstraction_readFlashByte(format++))){
+		if(c != '%'){
+			lcdScreenDriverInternal_emit(writer, c);
+			continue;
+		}
+		char padding = ' ';
+		uint8_t width = 0;
+		uint8_t fractionDigits = 0;
+		uint8_t isLong = 0;
+		c = memoryAbstraction_readFlashByte(format++);
+		if(c == '0'){
+			padding = '0';
+			c = memoryAbstraction_readFlashByte(format++);
+		}
+		while(c >= '0' && c <= '9'){
+			width = width * 10 + c - '0';
+			c = memoryAbstraction_readFlashByte(format++);
+		}
+		if(c == '.'){
+			c = memoryAbstraction_readFlashByte(format++);
+			while(c >= '0' && c <= '9'){
+				fractionDigits = fractionDigits * 10 + c - '0';
+				c = memoryAbstraction_readFlashByte(format++);
+			}
+		}
+		if(c == 'l'){
+			isLong = 1;
+			c = memoryAbstraction_readFlashByte(format++);
+		}
+		switch(c){
+			case 'd':
+				lcdScreenDriverInternal_renderSigned(writer, isLong ? va_arg(arguments, long) : va_arg(arguments, int), fractionDigits, width, padding);
+				break;
+			case 'u':
+				lcdScreenDriverInternal_renderDecimal(writer, isLong ? va_arg(arguments, unsigned long) : va_arg(arguments, unsigned int), 0, 0, width, padding);
+				break;
+			case 'x':
+				lcdScreenDriverInternal_renderHex(writer, isLong ? va_arg(arguments, unsigned long) : va_arg(arguments, unsigned int), width, padding);
+				break;
+			case 'c':
+				lcdScreenDriverInternal_emit(writer, (char) va_arg(arguments, int));
+				break;
+			case 's':{
+				const char* string = va_arg(arguments, const char*);
+				while(*string){
+					lcdScreenDriverInternal_emit(writer, *(string++));
+				}
+				break;
+			}
+			case 'S':
+				lcdScreenDriverInternal_emitFlashString(writer, va_arg(arguments, const char*));
+				break;
+			case '\0':
+				//a lone % at the end of the format
+				return;
+			default:
+				lcdScreenDriverInternal_emit(writer, c);
+				break;
+		}
+	}
+}
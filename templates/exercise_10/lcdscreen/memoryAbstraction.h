@@ -0,0 +1,28 @@
+#ifndef _MEMORYABSTRACTION_H
+#define _MEMORYABSTRACTION_H
+
+#include <stdint.h>
+
+//Constant tables in program memory. On the AVR flash is a separate address space and has to be read
+//with the LPM instruction, the host build keeps them in ordinary memory.
+//MEMORYABSTRACTION_FLASH_STRING places a string literal in flash, it can only be used inside a function.
+//Variables marked MEMORYABSTRACTION_NOINIT are left alone by the startup code and keep their content over
+//a reset that does not remove power. In the host build they are ordinary variables.
+#ifdef TEST
+#define MEMORYABSTRACTION_PROGMEM
+#define memoryAbstraction_readFlashByte(address) (*(const uint8_t*)(address))
+#define memoryAbstraction_readFlashWord(address) (*(const uint16_t*)(address))
+#define memoryAbstraction_readFlashDword(address) (*(const uint32_t*)(address))
+#define MEMORYABSTRACTION_FLASH_STRING(string) (string)
+#define MEMORYABSTRACTION_NOINIT
+#else
+#include <avr/pgmspace.h>
+#define MEMORYABSTRACTION_PROGMEM PROGMEM
+#define memoryAbstraction_readFlashByte(address) pgm_read_byte(address)
+#define memoryAbstraction_readFlashWord(address) pgm_read_word(address)
+#define memoryAbstraction_readFlashDword(address) pgm_read_dword(address)
+#define MEMORYABSTRACTION_FLASH_STRING(string) PSTR(string)
+#define MEMORYABSTRACTION_NOINIT __attribute__((section(".noinit")))
+#endif // TEST
+
+#endif // _MEMORYABSTRACTION_H
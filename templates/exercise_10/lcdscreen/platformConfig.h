@@ -3,26 +3,110 @@
 
 #ifdef TEST
 #include <stdint.h>
-#include <stdio.h>
-uint32_t fakeDelayMillisecondsCalled = 0;
-uint32_t fakeDelayMicrosecondsCalled = 0;
+#include "fakeTimeline.h"
 
-void fakeDelayForOneMillisecond(){
-	fakeDelayMillisecondsCalled++;
+//Virtual time: a wait of any length is one step of the fake clock and one event in the timeline
+#define TIMEBASE_MICROS_PER_TICK 0
+#define timeBaseInitialise()
+#define timeBaseNowMicros() fakeTimeline_delayClockMicros()
+//nothing on the host wakes a sleep early, it lasts until its deadline
+#define timeBaseInterruptsEnabled() 1
+#define timeBaseDisableInterrupts()
+#define timeBaseSleep(maxMicroseconds) fakeTimeline_delay(maxMicroseconds)
+#define busyWaitMicroseconds(microseconds) fakeTimeline_delay(microseconds)
+
+#else // TEST
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/delay.h>
+
+//_delay_us needs a constant, longer busy waits are made of single microseconds
+void busyWaitMicroseconds(uint32_t microseconds){
+	for (uint32_t i = 0; i < microseconds; ++i){
+		_delay_us(1);
+	}
 }
 
-#define delayForOneMillisecond() fakeDelayForOneMillisecond()
+//Timer0 runs freely with a prescaler of 64 and counts its overflows, 4us per tick at 16MHz
+#define TIMEBASE_PRESCALER 64
+#if ((TIMEBASE_PRESCALER * 1000000UL) % F_CPU) != 0
+#error "F_CPU does not give a whole number of microseconds per Timer0 tick"
+#endif
+#define TIMEBASE_MICROS_PER_TICK (TIMEBASE_PRESCALER * 1000000UL / F_CPU)
+
+volatile uint32_t timeBaseOverflowCount = 0;
 
-void fakeDelayForOneMicrosecond(){
-	fakeDelayMicrosecondsCalled++;
+ISR(TIMER0_OVF_vect){
+	timeBaseOverflowCount++;
 }
-#define delayForOneMicrosecond() fakeDelayForOneMicrosecond()
 
-#else // TEST
+void timeBaseInitialise(void){
+	TCCR0A = 0;
+	TCNT0 = 0;
+	TIFR0 = (1 << TOV0);
+	TCCR0B = (1 << CS01) | (1 << CS00);
+	TIMSK0 |= (1 << TOIE0);
+}
 
-#include <util/delay.h>
-#define delayForOneMillisecond() _delay_ms(1);
-#define delayForOneMicrosecond() _delay_us(1);
+uint32_t timeBaseNowMicros(void){
+	char cSREG = SREG;
+	cli();
+	uint32_t overflows = timeBaseOverflowCount;
+	uint8_t ticks = TCNT0;
+	if(TIFR0 & (1 << TOV0)){
+		if(!(cSREG & (1 << SREG_I))){
+			//nobody will run the overflow interrupt, count the overflow here
+			TIFR0 = (1 << TOV0);
+			timeBaseOverflowCount = ++overflows;
+			ticks = TCNT0;
+		}
+		else if(ticks < 0xFF){
+			//overflow happened after cli(), the interrupt is still pending
+			overflows++;
+		}
+	}
+	SREG = cSREG;
+	return ((overflows << 8) + ticks) * TIMEBASE_MICROS_PER_TICK;
+}
+
+#define timeBaseInterruptsEnabled() (SREG & (1 << SREG_I))
+#define timeBaseDisableInterrupts() cli()
+
+#ifdef POWER_BUSY_WAIT
+#define timeBaseSleep(maxMicroseconds) sei()
+#else
+//Fewer ticks are not worth the wake-up, the caller polls them
+#define TIMEBASE_MINIMUM_SLEEP_TICKS 2
+
+EMPTY_INTERRUPT(TIMER0_COMPB_vect);
+
+/*
+	IDLE sleep, the timers, the TWI and the USART keep running and any of their interrupts wakes the core.
+	A wait shorter than one Timer0 period is ended by compare match B, a longer one by the overflow every 1024us.
+	Entered with interrupts disabled: sei delays interrupts by one instruction, so nothing can fire between it and
+	the sleep instruction and an interrupt that became pending after the caller checked its condition still wakes it.
+*/
+void timeBaseSleep(uint32_t maxMicroseconds){
+	uint32_t ticks = maxMicroseconds / TIMEBASE_MICROS_PER_TICK;
+	if(ticks < TIMEBASE_MINIMUM_SLEEP_TICKS){
+		sei();
+		return;
+	}
+	if(ticks < 0x100){
+		OCR0B = TCNT0 + (uint8_t)ticks;
+		TIFR0 = (1 << OCF0B);
+		TIMSK0 |= (1 << OCIE0B);
+	}
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	sleep_enable();
+	sei();
+	sleep_cpu();
+	sleep_disable();
+	TIMSK0 &= ~(1 << OCIE0B);
+}
+#endif // POWER_BUSY_WAIT
 
 #endif //TEST
 
@@ -2,6 +2,9 @@
 
 #include <stdio.h>
 
+//With REGISTERABSTRACTION_STATIC_BINDING the accessors are inline functions of the header
+#ifndef REGISTERABSTRACTION_STATIC_BINDING
+
 void abstraction_setRegisterToValue(volatile uint8_t* targetRegister, uint8_t valueToSet) {
 	(*targetRegister) = valueToSet;
 }
@@ -21,3 +24,5 @@ uint8_t abstraction_isBitSet(volatile uint8_t* targetRegister, uint8_t bitToRead
 uint8_t abstraction_getRegisterValue(volatile uint8_t* targetRegister) {
 	return *targetRegister;
 }
+
+#endif // REGISTERABSTRACTION_STATIC_BINDING
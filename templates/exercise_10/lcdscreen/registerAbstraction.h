@@ -3,6 +3,29 @@
 
 #include <stdint.h>
 
+#ifdef REGISTERABSTRACTION_STATIC_BINDING
+//Header only accessors. With a register address that is a compile time constant, as the bindings in
+//i2cRegisterBinding.h give them, they compile to sbi, cbi, sbis, in and out instead of a call through a pointer.
+static inline void abstraction_setRegisterToValue(volatile uint8_t* targetRegister, uint8_t valueToSet) {
+	(*targetRegister) = valueToSet;
+}
+
+static inline void abstraction_setRegisterBitsHigh(volatile uint8_t* targetRegister, uint8_t bitmask) {
+	*targetRegister |= bitmask;
+}
+
+static inline void abstraction_setRegisterBitsLow(volatile uint8_t* targetRegister, uint8_t bitmask) {
+	*targetRegister &= ~bitmask;
+}
+
+static inline uint8_t abstraction_isBitSet(volatile uint8_t* targetRegister, uint8_t bitToRead) {
+	return ((*targetRegister) & (1 << bitToRead));
+}
+
+static inline uint8_t abstraction_getRegisterValue(volatile uint8_t* targetRegister) {
+	return *targetRegister;
+}
+#else
 void abstraction_setRegisterToValue(volatile uint8_t* targetRegister, uint8_t valueToSet);
 void abstraction_setRegisterBitsHigh(volatile uint8_t* targetRegister, uint8_t bitmask);
 void abstraction_setRegisterBitsLow(volatile uint8_t*  targetRegister, uint8_t bitmask);
@@ -10,5 +33,6 @@ void abstraction_setRegisterBitsLow(volatile uint8_t*  targetRegister, uint8_t b
 uint8_t abstraction_isBitSet(volatile uint8_t* targetRegister, uint8_t bitToRead);
 
 uint8_t abstraction_getRegisterValue(volatile uint8_t* targetRegister);
+#endif // REGISTERABSTRACTION_STATIC_BINDING
 
 #endif // _REGISTERABSTRACTION_H
@@ -0,0 +1,141 @@
+#ifdef PROFILING
+
+#include "profiler.h"
+
+#include <stdlib.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "memoryAbstraction.h"
+
+#define PROFILER_MAX_NUMBER_LENGTH 11
+
+#define PROFILER_POINT(identifier, name) const char profilerName_##identifier[] MEMORYABSTRACTION_PROGMEM = name;
+#include "profilerPoints.h"
+#undef PROFILER_POINT
+
+const char* const profilerNames[PROFILER_NUMBER_OF_POINTS] MEMORYABSTRACTION_PROGMEM = {
+#define PROFILER_POINT(identifier, name) profilerName_##identifier,
+#include "profilerPoints.h"
+#undef PROFILER_POINT
+};
+
+Profiler_Counters profilerCounters[PROFILER_NUMBER_OF_POINTS];
+volatile uint16_t profilerOverflowCount = 0;
+uint32_t profilerMarkerCycles = 0;
+
+ISR(TIMER1_OVF_vect){
+	profilerOverflowCount++;
+}
+
+void profiler_initialise(void){
+	//normal mode without prescaler, one count per CPU cycle
+	TCCR1A = 0;
+	TCCR1B = 0;
+	TCNT1 = 0;
+	TIFR1 = (1 << TOV1);
+	TIMSK1 |= (1 << TOIE1);
+	TCCR1B = (1 << CS10);
+	profiler_reset();
+
+	//an empty measurement is what the markers cost, every record takes it off
+	uint32_t startCycles = profiler_cycles();
+	profilerMarkerCycles = profiler_cycles() - startCycles;
+}
+
+//Same overflow handling as the time base: an overflow whose interrupt is still pending is counted here
+uint32_t profiler_cycles(void){
+	char cSREG = SREG;
+	cli();
+	uint16_t overflows = profilerOverflowCount;
+	uint16_t ticks = TCNT1;
+	if(TIFR1 & (1 << TOV1)){
+		if(!(cSREG & (1 << SREG_I))){
+			//nobody will run the overflow interrupt, count the overflow here
+			TIFR1 = (1 << TOV1);
+			profilerOverflowCount = ++overflows;
+			ticks = TCNT1;
+		}
+		else if(ticks < 0x8000){
+			//overflow happened after cli(), the interrupt is still pending
+			overflows++;
+		}
+	}
+	SREG = cSREG;
+	return ((uint32_t)overflows << 16) | ticks;
+}
+
+void profiler_record(Profiler_Point point, uint32_t startCycles){
+	uint32_t cycles = profiler_cycles() - startCycles;
+	cycles = cycles > profilerMarkerCycles ? cycles - profilerMarkerCycles : 0;
+	char cSREG = SREG;
+	cli();
+	Profiler_Counters* counters = &profilerCounters[point];
+	counters->calls++;
+	counters->totalCycles = (counters->totalCycles + cycles < counters->totalCycles) ? 0xFFFFFFFF : counters->totalCycles + cycles;
+	if(cycles < counters->minCycles){
+		counters->minCycles = cycles;
+	}
+	if(cycles > counters->maxCycles){
+		counters->maxCycles = cycles;
+	}
+	SREG = cSREG;
+}
+
+void profiler_getCounters(Profiler_Point point, Profiler_Counters* counters){
+	char cSREG = SREG;
+	cli();
+	*counters = profilerCounters[point];
+	SREG = cSREG;
+}
+
+void profiler_reset(void){
+	char cSREG = SREG;
+	cli();
+	for (uint8_t point = 0; point < PROFILER_NUMBER_OF_POINTS; ++point){
+		profilerCounters[point] = (Profiler_Counters){0, 0, 0xFFFFFFFF, 0};
+	}
+	SREG = cSREG;
+}
+
+void profilerInternal_putFlashString(Profiler_PutChar putChar, const char* string){
+	char c;
+	while((c = memoryAbstraction_readFlashByte(string++))){
+		putChar(c);
+	}
+}
+
+void profilerInternal_putNumber(Profiler_PutChar putChar, uint32_t value){
+	char digits[PROFILER_MAX_NUMBER_LENGTH];
+	ultoa(value, digits, 10);
+	putChar(' ');
+	for (char* c = digits; *c; ++c){
+		putChar(*c);
+	}
+}
+
+void profiler_dump(Profiler_PutChar putChar, uint8_t resetAfterDump){
+	profilerInternal_putFlashString(putChar, MEMORYABSTRACTION_FLASH_STRING("PROF BEGIN"));
+	profilerInternal_putNumber(putChar, F_CPU);
+	putChar('\n');
+	for (uint8_t point = 0; point < PROFILER_NUMBER_OF_POINTS; ++point){
+		Profiler_Counters counters;
+		profiler_getCounters(point, &counters);
+		if(counters.calls == 0){
+			continue;
+		}
+		profilerInternal_putFlashString(putChar, MEMORYABSTRACTION_FLASH_STRING("PROF "));
+		profilerInternal_putFlashString(putChar, (const char*)(uintptr_t)memoryAbstraction_readFlashWord(&profilerNames[point]));
+		profilerInternal_putNumber(putChar, counters.calls);
+		profilerInternal_putNumber(putChar, counters.totalCycles);
+		profilerInternal_putNumber(putChar, counters.minCycles);
+		profilerInternal_putNumber(putChar, counters.maxCycles);
+		putChar('\n');
+	}
+	profilerInternal_putFlashString(putChar, MEMORYABSTRACTION_FLASH_STRING("PROF END\n"));
+	if(resetAfterDump){
+		profiler_reset();
+	}
+}
+
+#endif // PROFILING
@@ -0,0 +1,62 @@
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+#include <stdint.h>
+
+/*
+	Cycle profiler of the target. PROFILE_BEGIN and PROFILE_END around a function body measure it with Timer1,
+	which runs at the CPU clock, and collect call count, total, minimum and maximum cycles per profile point.
+	The cost of the markers themselves is measured once in profiler_initialise and taken off every call.
+
+	Enabled with PROFILING=1 in the Makefile (-DPROFILING), otherwise the markers compile to nothing and
+	the profiler takes no flash, RAM or timer. Timer1 is then free for other uses again.
+*/
+
+typedef enum{
+#define PROFILER_POINT(identifier, name) identifier,
+#include "profilerPoints.h"
+#undef PROFILER_POINT
+	PROFILER_NUMBER_OF_POINTS
+}Profiler_Point;
+
+typedef struct{
+	uint32_t calls;
+	uint32_t totalCycles; //stops at 0xFFFFFFFF, about 268s at 16MHz, a dump resets it
+	uint32_t minCycles;
+	uint32_t maxCycles;
+}Profiler_Counters;
+
+typedef void (*Profiler_PutChar)(char c);
+
+#ifdef PROFILING
+
+#ifdef TEST
+#error "PROFILING needs Timer1 of the target"
+#endif
+
+//BEGIN opens a scope variable, END has to be in the same block before every return
+#define PROFILE_BEGIN(point) uint32_t profileStart_##point = profiler_cycles()
+#define PROFILE_END(point) profiler_record(point, profileStart_##point)
+
+void profiler_initialise(void);
+uint32_t profiler_cycles(void);
+void profiler_record(Profiler_Point point, uint32_t startCycles);
+void profiler_getCounters(Profiler_Point point, Profiler_Counters* counters);
+void profiler_reset(void);
+/*
+	Sends the table as text lines, framed so serial_echo.py can collect them into a report:
+		PROF BEGIN <cpu clock in Hz>
+		PROF <name> <calls> <total> <min> <max>
+		PROF END
+	Points that were never called are left out. resetAfterDump starts a new measurement period.
+*/
+void profiler_dump(Profiler_PutChar putChar, uint8_t resetAfterDump);
+
+#else
+
+#define PROFILE_BEGIN(point)
+#define PROFILE_END(point)
+
+#endif // PROFILING
+
+#endif // _PROFILER_H
@@ -0,0 +1,18 @@
+/*
+	Profile points, one PROFILER_POINT(identifier, name) per measured function.
+	The identifier becomes a Profiler_Point numbered in the order of this file, the name is what the dump
+	and serial_echo.py show for it.
+
+	No include guard, the file is included once per expansion.
+*/
+
+PROFILER_POINT(PROFILE_I2C_START, "i2c_sendStartCondition")
+PROFILER_POINT(PROFILE_I2C_WRITE, "i2c_writeBytes")
+PROFILER_POINT(PROFILE_I2C_READ, "i2c_readBytes")
+PROFILER_POINT(PROFILE_I2C_STOP, "i2c_sendStopCondition")
+PROFILER_POINT(PROFILE_I2C_WAIT, "i2c_waitForTransaction")
+PROFILER_POINT(PROFILE_LCD_WRITE_NIBBLE, "lcdScreenDriverInternal_writeNibble")
+PROFILER_POINT(PROFILE_LCD_EXPANDER_SEQUENCE, "lcdScreenDriverInternal_writeExpanderSequence")
+PROFILER_POINT(PROFILE_LCD_FLUSH, "lcdScreenDriver_flush")
+PROFILER_POINT(PROFILE_DELAY_MICROSECONDS, "delayAbstraction_delayMicroseconds")
+PROFILER_POINT(PROFILE_DELAY_MILLISECONDS, "delayAbstraction_delayMilliseconds")
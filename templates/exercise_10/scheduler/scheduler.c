@@ -0,0 +1,158 @@
+#include "scheduler.h"
+#include "scheduler_internal.h"
+
+#include "delayAbstraction.h"
+
+Scheduler_Task tasks[SCHEDULER_MAX_TASKS];
+uint8_t currentTask = SCHEDULER_INVALID_TASK;
+//Never reaches the value a delayed task waits for, only the timeout of the wait runs it again
+volatile uint8_t schedulerNoEvent = 0;
+
+uint8_t scheduler_addPeriodicTask(Scheduler_TaskFunction function, void* argument, uint32_t periodMicros, uint32_t firstDelayMicros){
+	if(periodMicros == 0){
+		return SCHEDULER_INVALID_TASK;
+	}
+	return schedulerInternal_addTask(function, argument, SCHEDULER_TASKTYPE_PERIODIC, periodMicros, firstDelayMicros);
+}
+
+uint8_t scheduler_addOneShotTask(Scheduler_TaskFunction function, void* argument, uint32_t delayMicros){
+	return schedulerInternal_addTask(function, argument, SCHEDULER_TASKTYPE_ONESHOT, 0, delayMicros);
+}
+
+void scheduler_removeTask(uint8_t taskId){
+	if(taskId < SCHEDULER_MAX_TASKS){
+		tasks[taskId].type = SCHEDULER_TASKTYPE_FREE;
+	}
+}
+
+uint8_t scheduler_waitForEvent(uint8_t taskId, volatile uint8_t* eventFlag, uint8_t eventValue, uint32_t timeoutMicros){
+	if(taskId >= SCHEDULER_MAX_TASKS || tasks[taskId].type == SCHEDULER_TASKTYPE_FREE || eventFlag == 0){
+		return SCHEDULER_ERRORCODE_INVALIDPARAMS;
+	}
+	tasks[taskId].eventFlag = eventFlag;
+	tasks[taskId].eventValue = eventValue;
+	delayAbstraction_startTimeout(&tasks[taskId].eventTimeout, timeoutMicros);
+	return SCHEDULER_ERRORCODE_ALL_OK;
+}
+
+uint8_t scheduler_delayTask(uint8_t taskId, uint32_t delayMicros){
+	return scheduler_waitForEvent(taskId, &schedulerNoEvent, 1, delayMicros);
+}
+
+uint8_t scheduler_getCurrentTask(void){
+	return currentTask;
+}
+
+uint8_t scheduler_getTaskStatistics(uint8_t taskId, Scheduler_TaskStatistics* statistics){
+	if(taskId >= SCHEDULER_MAX_TASKS || statistics == 0){
+		return SCHEDULER_ERRORCODE_INVALIDPARAMS;
+	}
+	*statistics = tasks[taskId].statistics;
+	return SCHEDULER_ERRORCODE_ALL_OK;
+}
+
+//Runs every task that is ready once, in table order
+void scheduler_runOnce(void){
+	for (uint8_t taskId = 0; taskId < SCHEDULER_MAX_TASKS; ++taskId){
+		if(schedulerInternal_isReady(&tasks[taskId], delayAbstraction_nowMicros())){
+			schedulerInternal_runTask(taskId);
+		}
+	}
+}
+
+//Between the releases the MCU sleeps, an interrupt that sets an event flag wakes it early
+void scheduler_run(void){
+	while(1){
+		scheduler_runOnce();
+		if(delayAbstraction_prepareSleep()){
+			delayAbstraction_sleepUntilInterrupt(schedulerInternal_getIdleMicros(delayAbstraction_nowMicros()));
+		}
+	}
+}
+
+//##################################
+//Internal applications
+uint8_t schedulerInternal_addTask(Scheduler_TaskFunction function, void* argument, uint8_t type, uint32_t periodMicros, uint32_t firstDelayMicros){
+	if(function == 0){
+		return SCHEDULER_INVALID_TASK;
+	}
+	for (uint8_t taskId = 0; taskId < SCHEDULER_MAX_TASKS; ++taskId){
+		Scheduler_Task* task = &tasks[taskId];
+		if(task->type != SCHEDULER_TASKTYPE_FREE){
+			continue;
+		}
+		task->function = function;
+		task->argument = argument;
+		task->periodMicros = periodMicros;
+		task->nextReleaseMicros = delayAbstraction_nowMicros() + firstDelayMicros;
+		task->eventFlag = 0;
+		task->statistics = (Scheduler_TaskStatistics){0};
+		task->type = type;
+		return taskId;
+	}
+	return SCHEDULER_INVALID_TASK;
+}
+
+uint8_t schedulerInternal_isReady(Scheduler_Task* task, uint32_t now){
+	if(task->type == SCHEDULER_TASKTYPE_FREE){
+		return 0;
+	}
+	if(task->eventFlag){
+		return *(task->eventFlag) == task->eventValue || delayAbstraction_hasExpired(&task->eventTimeout);
+	}
+	return (int32_t)(now - task->nextReleaseMicros) >= 0;
+}
+
+//Time until the first task becomes ready, 0 when one is ready already
+uint32_t schedulerInternal_getIdleMicros(uint32_t now){
+	uint32_t idleMicros = SCHEDULER_MAX_IDLE_US;
+	for (uint8_t taskId = 0; taskId < SCHEDULER_MAX_TASKS; ++taskId){
+		Scheduler_Task* task = &tasks[taskId];
+		if(task->type == SCHEDULER_TASKTYPE_FREE){
+			continue;
+		}
+		if(schedulerInternal_isReady(task, now)){
+			return 0;
+		}
+		uint32_t untilReady = task->eventFlag ? delayAbstraction_remainingMicros(&task->eventTimeout) : task->nextReleaseMicros - now;
+		if(untilReady < idleMicros){
+			idleMicros = untilReady;
+		}
+	}
+	return idleMicros;
+}
+
+void schedulerInternal_runTask(uint8_t taskId){
+	Scheduler_Task* task = &tasks[taskId];
+	uint8_t wokenByEvent = task->eventFlag != 0;
+	task->eventFlag = 0;
+
+	uint32_t startTime = delayAbstraction_nowMicros();
+	currentTask = taskId;
+	task->function(task->argument);
+	currentTask = SCHEDULER_INVALID_TASK;
+	uint32_t endTime = delayAbstraction_nowMicros();
+
+	uint32_t runTime = endTime - startTime;
+	task->statistics.runCount++;
+	task->statistics.totalRunTimeMicros += runTime;
+	if(runTime > task->statistics.maxRunTimeMicros){
+		task->statistics.maxRunTimeMicros = runTime;
+	}
+
+	if(task->type == SCHEDULER_TASKTYPE_FREE){
+		return;
+	}
+	//only a release run advances the period, an event wake-up belongs to the release that started the wait
+	if(task->type == SCHEDULER_TASKTYPE_PERIODIC && !wokenByEvent){
+		task->nextReleaseMicros += task->periodMicros;
+		if((int32_t)(endTime - task->nextReleaseMicros) >= 0){
+			//missed the next release, count it and restart the period instead of running a burst of late releases
+			task->statistics.overrunCount++;
+			task->nextReleaseMicros = endTime + task->periodMicros;
+		}
+	}
+	if(task->type == SCHEDULER_TASKTYPE_ONESHOT && task->eventFlag == 0){
+		task->type = SCHEDULER_TASKTYPE_FREE;
+	}
+}
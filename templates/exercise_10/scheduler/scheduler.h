@@ -0,0 +1,39 @@
+#ifndef _SCHEDULER_H
+#define _SCHEDULER_H
+
+#include <stdint.h>
+
+#ifndef SCHEDULER_MAX_TASKS
+#define SCHEDULER_MAX_TASKS 8
+#endif
+
+#define SCHEDULER_INVALID_TASK 0xFF
+
+#define SCHEDULER_ERRORCODE_ALL_OK 0x00
+#define SCHEDULER_ERRORCODE_INVALIDPARAMS 0x01
+
+typedef void (*Scheduler_TaskFunction)(void* argument);
+
+typedef struct{
+	uint32_t runCount;
+	uint32_t totalRunTimeMicros;
+	uint32_t maxRunTimeMicros;
+	uint16_t overrunCount; //runs that finished after the next release of the task was already due
+}Scheduler_TaskStatistics;
+
+//Cooperative run-to-completion scheduler, tasks must return quickly and never block.
+//A task can instead wait for an I/O completion flag (e.g. the state of an I2C_Transaction)
+//with scheduler_waitForEvent and is run again once the flag reaches the value or the timeout expires.
+
+uint8_t scheduler_addPeriodicTask(Scheduler_TaskFunction function, void* argument, uint32_t periodMicros, uint32_t firstDelayMicros);
+uint8_t scheduler_addOneShotTask(Scheduler_TaskFunction function, void* argument, uint32_t delayMicros);
+void scheduler_removeTask(uint8_t taskId);
+uint8_t scheduler_waitForEvent(uint8_t taskId, volatile uint8_t* eventFlag, uint8_t eventValue, uint32_t timeoutMicros);
+//Runs the task again after the delay instead of at its next release, e.g. while a device converts
+uint8_t scheduler_delayTask(uint8_t taskId, uint32_t delayMicros);
+uint8_t scheduler_getCurrentTask(void);
+uint8_t scheduler_getTaskStatistics(uint8_t taskId, Scheduler_TaskStatistics* statistics);
+void scheduler_runOnce(void);
+void scheduler_run(void);
+
+#endif // _SCHEDULER_H
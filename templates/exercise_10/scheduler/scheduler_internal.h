@@ -0,0 +1,32 @@
+#ifndef _SCHEDULER_INTERNAL_H
+#define _SCHEDULER_INTERNAL_H
+
+#include <stdint.h>
+#include "scheduler.h"
+#include "delayAbstraction.h"
+
+#define SCHEDULER_TASKTYPE_FREE 0
+#define SCHEDULER_TASKTYPE_PERIODIC 1
+#define SCHEDULER_TASKTYPE_ONESHOT 2
+
+//Longest sleep without a task to wake up for, the loop checks again afterwards
+#define SCHEDULER_MAX_IDLE_US 1000000UL
+
+typedef struct{
+	Scheduler_TaskFunction function;
+	void* argument;
+	uint8_t type;
+	uint32_t periodMicros;
+	uint32_t nextReleaseMicros;
+	volatile uint8_t* eventFlag;
+	uint8_t eventValue;
+	DelayAbstraction_Timeout eventTimeout;
+	Scheduler_TaskStatistics statistics;
+}Scheduler_Task;
+
+uint8_t schedulerInternal_addTask(Scheduler_TaskFunction function, void* argument, uint8_t type, uint32_t periodMicros, uint32_t firstDelayMicros);
+uint8_t schedulerInternal_isReady(Scheduler_Task* task, uint32_t now);
+uint32_t schedulerInternal_getIdleMicros(uint32_t now);
+void schedulerInternal_runTask(uint8_t taskId);
+
+#endif //_SCHEDULER_INTERNAL_H
@@ -0,0 +1,245 @@
+#ifdef INTEGRATION_BME680
+
+#include "bme680.h"
+#include "bme680_internal.h"
+
+#include "i2cInterface.h"
+#include "delayAbstraction.h"
+
+uint8_t bme680_initialise(Bme680_Device* device, uint8_t address, uint8_t temperatureOversampling, uint8_t pressureOversampling, uint8_t humidityOversampling, uint8_t filter){
+	if(device == 0 || temperatureOversampling > BME680_OVERSAMPLING_16X || pressureOversampling > BME680_OVERSAMPLING_16X || humidityOversampling > BME680_OVERSAMPLING_16X || filter > BME680_FILTER_MAX){
+		return BME680_ERRORCODE_INVALIDPARAMS;
+	}
+	device->address = address;
+	device->lastError = I2C_CODES_NO_ERROR;
+	if(i2c_computeClockSetting(BME680_I2C_CLOCK, &device->clockSetting, 0)){
+		return BME680_ERRORCODE_INVALIDPARAMS;
+	}
+
+	uint8_t chipId = 0;
+	if(bme680Internal_transfer(device, BME680_REGISTER_CHIP_ID, 0, 0, &chipId, 1)){
+		return BME680_ERRORCODE_I2C;
+	}
+	if(chipId != BME680_CHIP_ID){
+		return BME680_ERRORCODE_WRONG_CHIP;
+	}
+	if(bme680Internal_writeRegister(device, BME680_REGISTER_RESET, BME680_RESET_COMMAND)){
+		return BME680_ERRORCODE_I2C;
+	}
+	delayAbstraction_delayMilliseconds(BME680_RESET_MS);
+
+	uint8_t calibration[BME680_CALIBRATION_1_LENGTH + BME680_CALIBRATION_2_LENGTH];
+	if(bme680Internal_transfer(device, BME680_REGISTER_CALIBRATION_1, 0, 0, calibration, BME680_CALIBRATION_1_LENGTH)
+		|| bme680Internal_transfer(device, BME680_REGISTER_CALIBRATION_2, 0, 0, calibration + BME680_CALIBRATION_1_LENGTH, BME680_CALIBRATION_2_LENGTH)){
+		return BME680_ERRORCODE_I2C;
+	}
+	bme680Internal_decodeCalibration(&device->calibration, calibration);
+
+	//the sensor takes no auto-incremented writes, every register is written on its own
+	device->measureControl = (temperatureOversampling << BME680_SHIFT_OVERSAMPLING_TEMPERATURE) | (pressureOversampling << BME680_SHIFT_OVERSAMPLING_PRESSURE);
+	if(bme680Internal_writeRegister(device, BME680_REGISTER_CONTROL_GAS_0, BME680_HEATER_OFF)
+		|| bme680Internal_writeRegister(device, BME680_REGISTER_CONTROL_GAS_1, 0)
+		|| bme680Internal_writeRegister(device, BME680_REGISTER_CONTROL_HUMIDITY, humidityOversampling)
+		|| bme680Internal_writeRegister(device, BME680_REGISTER_CONFIG, filter << BME680_SHIFT_FILTER)
+		|| bme680Internal_writeRegister(device, BME680_REGISTER_CONTROL_MEASURE, device->measureControl)){
+		return BME680_ERRORCODE_I2C;
+	}
+
+	uint32_t cycles = bme680Internal_getOversamplingCycles(temperatureOversampling) + bme680Internal_getOversamplingCycles(pressureOversampling) + bme680Internal_getOversamplingCycles(humidityOversampling);
+	device->measurementMicros = cycles * BME680_CYCLE_US + BME680_MEASUREMENT_OVERHEAD_US;
+	return BME680_ERRORCODE_ALL_OK;
+}
+
+uint32_t bme680_getMeasurementMicros(Bme680_Device* device){
+	return device->measurementMicros;
+}
+
+uint8_t bme680_startMeasurement(Bme680_Device* device, I2C_Transaction* transaction){
+	bme680Internal_prepareTransaction(device, transaction, BME680_REGISTER_CONTROL_MEASURE);
+	device->field[0] = device->measureControl | BME680_MODE_FORCED;
+	transaction->txBuffer = device->field;
+	transaction->txLength = 1;
+	return i2c_submitTransaction(transaction);
+}
+
+uint8_t bme680_startFieldRead(Bme680_Device* device, I2C_Transaction* transaction){
+	bme680Internal_prepareTransaction(device, transaction, BME680_REGISTER_FIELD0);
+	transaction->rxBuffer = device->field;
+	transaction->rxLength = BME680_FIELD_LENGTH;
+	return i2c_submitTransaction(transaction);
+}
+
+uint8_t bme680_getRawData(Bme680_Device* device, Bme680_RawData* raw){
+	uint8_t* field = device->field;
+	if(!(field[BME680_FIELD_STATUS] & BME680_STATUS_NEW_DATA)){
+		return 0;
+	}
+	raw->pressure = bme680Internal_readAdc20(&field[BME680_FIELD_PRESSURE]);
+	raw->temperature = bme680Internal_readAdc20(&field[BME680_FIELD_TEMPERATURE]);
+	raw->humidity = ((uint16_t)field[BME680_FIELD_HUMIDITY] << 8) | field[BME680_FIELD_HUMIDITY + 1];
+	return 1;
+}
+
+#ifdef BME680_FLOAT_POINT_COMPENSATION
+
+void bme680_compensate(Bme680_Device* device, Bme680_RawData* raw, Bme680_Measurement* measurement){
+	Bme680_Calibration* c = &device->calibration;
+
+	float var1 = ((float)raw->temperature / 16384.0f - (float)c->t1 / 1024.0f) * (float)c->t2;
+	float var2 = (float)raw->temperature / 131072.0f - (float)c->t1 / 8192.0f;
+	var2 = var2 * var2 * ((float)c->t3 * 16.0f);
+	float tFine = var1 + var2;
+	float temperature = tFine / 5120.0f;
+	measurement->temperature = (int16_t)(temperature * 100.0f + (temperature < 0 ? -0.5f : 0.5f));
+
+	var1 = tFine / 2.0f - 64000.0f;
+	var2 = var1 * var1 * ((float)c->p6 / 131072.0f);
+	var2 = var2 + var1 * (float)c->p5 * 2.0f;
+	var2 = var2 / 4.0f + (float)c->p4 * 65536.0f;
+	var1 = ((float)c->p3 * var1 * var1 / 16384.0f + (float)c->p2 * var1) / 524288.0f;
+	var1 = (1.0f + var1 / 32768.0f) * (float)c->p1;
+	float pressure = 0;
+	if(var1 != 0){
+		pressure = ((1048576.0f - (float)raw->pressure) - var2 / 4096.0f) * 6250.0f / var1;
+		float scaled = pressure / 256.0f;
+		var1 = (float)c->p9 * pressure * pressure / 2147483648.0f;
+		var2 = pressure * ((float)c->p8 / 32768.0f);
+		float var3 = scaled * scaled * scaled * ((float)c->p10 / 131072.0f);
+		pressure = pressure + (var1 + var2 + var3 + (float)c->p7 * 128.0f) / 16.0f;
+	}
+	measurement->pressure = pressure > 0 ? (uint32_t)(pressure + 0.5f) : 0;
+
+	var1 = (float)raw->humidity - ((float)c->h1 * 16.0f + ((float)c->h3 / 2.0f) * temperature);
+	var2 = var1 * (((float)c->h2 / 262144.0f) * (1.0f + ((float)c->h4 / 16384.0f) * temperature + ((float)c->h5 / 1048576.0f) * temperature * temperature));
+	float humidity = var2 + ((float)c->h6 / 16384.0f + ((float)c->h7 / 2097152.0f) * temperature) * var2 * var2;
+	if(humidity < 0){
+		humidity = 0;
+	}
+	else if(humidity > 100.0f){
+		humidity = 100.0f;
+	}
+	measurement->humidity = (uint32_t)(humidity * 1000.0f + 0.5f);
+}
+
+#else
+
+void bme680_compensate(Bme680_Device* device, Bme680_RawData* raw, Bme680_Measurement* measurement){
+	Bme680_Calibration* c = &device->calibration;
+
+	int32_t var1 = ((int32_t)raw->temperature >> 3) - ((int32_t)c->t1 << 1);
+	int32_t var2 = (var1 * (int32_t)c->t2) >> 11;
+	int32_t var3 = ((var1 >> 1) * (var1 >> 1)) >> 12;
+	var3 = (var3 * ((int32_t)c->t3 << 4)) >> 14;
+	int32_t tFine = var2 + var3;
+	measurement->temperature = (int16_t)((tFine * 5 + 128) >> 8);
+
+	var1 = (tFine >> 1) - 64000;
+	var2 = ((((var1 >> 2) * (var1 >> 2)) >> 11) * (int32_t)c->p6) >> 2;
+	var2 = var2 + ((var1 * (int32_t)c->p5) << 1);
+	var2 = (var2 >> 2) + ((int32_t)c->p4 << 16);
+	var1 = (((((var1 >> 2) * (var1 >> 2)) >> 13) * ((int32_t)c->p3 << 5)) >> 3) + (((int32_t)c->p2 * var1) >> 1);
+	var1 = var1 >> 18;
+	var1 = ((32768 + var1) * (int32_t)c->p1) >> 15;
+	int32_t pressure = 1048576 - (int32_t)raw->pressure;
+	pressure = (int32_t)((pressure - (var2 >> 12)) * (uint32_t)3125);
+	if(var1 == 0){
+		pressure = 0;
+	}
+	//the division is done before the doubling where the doubling would overflow
+	else if(pressure >= (int32_t)0x40000000){
+		pressure = (pressure / var1) << 1;
+	}
+	else{
+		pressure = (pressure << 1) / var1;
+	}
+	var1 = ((int32_t)c->p9 * (int32_t)(((pressure >> 3) * (pressure >> 3)) >> 13)) >> 12;
+	var2 = ((int32_t)(pressure >> 2) * (int32_t)c->p8) >> 13;
+	var3 = ((int32_t)(pressure >> 8) * (int32_t)(pressure >> 8) * (int32_t)(pressure >> 8) * (int32_t)c->p10) >> 17;
+	pressure = pressure + ((var1 + var2 + var3 + ((int32_t)c->p7 << 7)) >> 4);
+	measurement->pressure = pressure > 0 ? (uint32_t)pressure : 0;
+
+	int32_t temperature = (tFine * 5 + 128) >> 8;
+	var1 = ((int32_t)raw->humidity - (int32_t)c->h1 * 16) - (((temperature * (int32_t)c->h3) / 100) >> 1);
+	var2 = ((int32_t)c->h2 * (((temperature * (int32_t)c->h4) / 100) + (((temperature * ((temperature * (int32_t)c->h5) / 100)) >> 6) / 100) + (1L << 14))) >> 10;
+	var3 = var1 * var2;
+	int32_t var4 = ((((int32_t)c->h6 << 7) + ((temperature * (int32_t)c->h7) / 100)) >> 4);
+	int32_t var5 = ((var3 >> 14) * (var3 >> 14)) >> 10;
+	int32_t var6 = (var4 * var5) >> 1;
+	int32_t humidity = (((var3 + var6) >> 10) * 1000) >> 12;
+	if(humidity < 0){
+		humidity = 0;
+	}
+	else if(humidity > 100000){
+		humidity = 100000;
+	}
+	measurement->humidity = (uint32_t)humidity;
+}
+
+#endif // BME680_FLOAT_POINT_COMPENSATION
+
+//##################################
+//Internal applications
+uint8_t bme680Internal_transfer(Bme680_Device* device, uint8_t registerAddress, uint8_t* txBuffer, uint16_t txLength, uint8_t* rxBuffer, uint16_t rxLength){
+	I2C_Transaction transaction;
+	bme680Internal_prepareTransaction(device, &transaction, registerAddress);
+	transaction.txBuffer = txBuffer;
+	transaction.txLength = txLength;
+	transaction.rxBuffer = rxBuffer;
+	transaction.rxLength = rxLength;
+	uint8_t errorcode = i2c_submitTransaction(&transaction);
+	if(!errorcode){
+		errorcode = i2c_waitForTransaction(&transaction);
+	}
+	if(errorcode){
+		device->lastError = errorcode;
+	}
+	return errorcode;
+}
+
+uint8_t bme680Internal_writeRegister(Bme680_Device* device, uint8_t registerAddress, uint8_t value){
+	return bme680Internal_transfer(device, registerAddress, &value, 1, 0, 0);
+}
+
+void bme680Internal_prepareTransaction(Bme680_Device* device, I2C_Transaction* transaction, uint8_t registerAddress){
+	*transaction = (I2C_Transaction){0};
+	transaction->slaveAddress = device->address;
+	transaction->flags = I2C_TRANSACTION_FLAG_REGISTER;
+	transaction->clockSetting = &device->clockSetting;
+	transaction->registerAddress = registerAddress;
+}
+
+void bme680Internal_decodeCalibration(Bme680_Calibration* calibration, uint8_t* data){
+	calibration->t1 = ((uint16_t)data[BME680_CALIBRATION_T1 + 1] << 8) | data[BME680_CALIBRATION_T1];
+	calibration->t2 = (int16_t)(((uint16_t)data[BME680_CALIBRATION_T2 + 1] << 8) | data[BME680_CALIBRATION_T2]);
+	calibration->t3 = (int8_t)data[BME680_CALIBRATION_T3];
+	calibration->p1 = ((uint16_t)data[BME680_CALIBRATION_P1 + 1] << 8) | data[BME680_CALIBRATION_P1];
+	calibration->p2 = (int16_t)(((uint16_t)data[BME680_CALIBRATION_P2 + 1] << 8) | data[BME680_CALIBRATION_P2]);
+	calibration->p3 = (int8_t)data[BME680_CALIBRATION_P3];
+	calibration->p4 = (int16_t)(((uint16_t)data[BME680_CALIBRATION_P4 + 1] << 8) | data[BME680_CALIBRATION_P4]);
+	calibration->p5 = (int16_t)(((uint16_t)data[BME680_CALIBRATION_P5 + 1] << 8) | data[BME680_CALIBRATION_P5]);
+	calibration->p6 = (int8_t)data[BME680_CALIBRATION_P6];
+	calibration->p7 = (int8_t)data[BME680_CALIBRATION_P7];
+	calibration->p8 = (int16_t)(((uint16_t)data[BME680_CALIBRATION_P8 + 1] << 8) | data[BME680_CALIBRATION_P8]);
+	calibration->p9 = (int16_t)(((uint16_t)data[BME680_CALIBRATION_P9 + 1] << 8) | data[BME680_CALIBRATION_P9]);
+	calibration->p10 = data[BME680_CALIBRATION_P10];
+	//h1 and h2 are 12 bit values sharing the byte in between
+	calibration->h1 = ((uint16_t)data[BME680_CALIBRATION_H1_MSB] << 4) | (data[BME680_CALIBRATION_H1_H2_LSB] & 0x0F);
+	calibration->h2 = ((uint16_t)data[BME680_CALIBRATION_H2_MSB] << 4) | (data[BME680_CALIBRATION_H1_H2_LSB] >> 4);
+	calibration->h3 = (int8_t)data[BME680_CALIBRATION_H3];
+	calibration->h4 = (int8_t)data[BME680_CALIBRATION_H4];
+	calibration->h5 = (int8_t)data[BME680_CALIBRATION_H5];
+	calibration->h6 = data[BME680_CALIBRATION_H6];
+	calibration->h7 = (int8_t)data[BME680_CALIBRATION_H7];
+}
+
+//1x, 2x, 4x, 8x, 16x
+uint32_t bme680Internal_getOversamplingCycles(uint8_t oversampling){
+	return oversampling ? (1UL << (oversampling - 1)) : 0;
+}
+
+//msb, lsb and the upper nibble of xlsb
+uint32_t bme680Internal_readAdc20(uint8_t* data){
+	return ((uint32_t)data[0] << 12) | ((uint32_t)data[1] << 4) | (data[2] >> 4);
+}
+
+#endif // INTEGRATION_BME680
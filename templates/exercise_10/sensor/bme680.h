@@ -0,0 +1,99 @@
+#ifndef _BME680_H
+#define _BME680_H
+
+#include <stdint.h>
+#include "i2cInterface.h"
+
+#define BME680_ERRORCODE_ALL_OK 0x00
+#define BME680_ERRORCODE_INVALIDPARAMS 0x01
+#define BME680_ERRORCODE_WRONG_CHIP 0x02
+#define BME680_ERRORCODE_I2C 0x03 //the I2C_CODES_* value is in lastError of the device
+
+//SDO to GND, 0x77 with SDO to VDDIO
+#define BME680_ADDRESS_PRIMARY 0x76
+#define BME680_ADDRESS_SECONDARY 0x77
+#define BME680_I2C_CLOCK 400000L
+
+#define BME680_OVERSAMPLING_SKIP 0
+#define BME680_OVERSAMPLING_1X 1
+#define BME680_OVERSAMPLING_2X 2
+#define BME680_OVERSAMPLING_4X 3
+#define BME680_OVERSAMPLING_8X 4
+#define BME680_OVERSAMPLING_16X 5
+
+//IIR filter on temperature and pressure, coefficient 2^filter - 1
+#define BME680_FILTER_OFF 0
+#define BME680_FILTER_MAX 7
+
+//Status, sub measurement index, pressure, temperature, humidity, reserved and gas registers of field 0
+#define BME680_FIELD_LENGTH 15
+
+typedef struct{
+	uint16_t t1;
+	int16_t t2;
+	int8_t t3;
+	uint16_t p1;
+	int16_t p2;
+	int8_t p3;
+	int16_t p4;
+	int16_t p5;
+	int8_t p6;
+	int8_t p7;
+	int16_t p8;
+	int16_t p9;
+	uint8_t p10;
+	uint16_t h1;
+	uint16_t h2;
+	int8_t h3;
+	int8_t h4;
+	int8_t h5;
+	uint8_t h6;
+	int8_t h7;
+}Bme680_Calibration;
+
+typedef struct{
+	uint8_t address;
+	uint8_t measureControl; //ctrl_meas with the oversampling settings, the mode bits are added for a measurement
+	uint32_t measurementMicros;
+	uint8_t lastError;
+	I2C_ClockSetting clockSetting;
+	Bme680_Calibration calibration;
+	uint8_t field[BME680_FIELD_LENGTH]; //buffer of the asynchronous transfers, the trigger uses its first byte
+}Bme680_Device;
+
+typedef struct{
+	uint32_t pressure;
+	uint32_t temperature;
+	uint16_t humidity;
+}Bme680_RawData;
+
+typedef struct{
+	int16_t temperature; //0.01 degC
+	uint32_t pressure; //Pa
+	uint32_t humidity; //0.001 %rH
+}Bme680_Measurement;
+
+/*
+	Blocking set up at start-up: checks the chip id, resets the sensor, reads its calibration and writes the
+	oversampling and filter settings. The heater stays off, the driver measures temperature, pressure and humidity.
+	The bus has to be set up with i2c_init before. The sensor runs at BME680_I2C_CLOCK whatever the other
+	devices on the bus use.
+*/
+uint8_t bme680_initialise(Bme680_Device* device, uint8_t address, uint8_t temperatureOversampling, uint8_t pressureOversampling, uint8_t humidityOversampling, uint8_t filter);
+//Time from the trigger until the results are ready, from the oversampling settings
+uint32_t bme680_getMeasurementMicros(Bme680_Device* device);
+
+/*
+	Asynchronous helpers, they fill the transaction and submit it, the caller waits for its state instead of
+	the bus, e.g. with scheduler_waitForEvent. The transaction has to stay valid until it is done.
+	startMeasurement starts one conversion in forced mode, the sensor goes back to sleep after it.
+	startFieldRead reads all result registers of field 0 in one burst into the field buffer of the device.
+*/
+uint8_t bme680_startMeasurement(Bme680_Device* device, I2C_Transaction* transaction);
+uint8_t bme680_startFieldRead(Bme680_Device* device, I2C_Transaction* transaction);
+//Results of the last field read, returns 0 when the conversion was not finished yet
+uint8_t bme680_getRawData(Bme680_Device* device, Bme680_RawData* raw);
+//Integer formulas of the datasheet, BME680_FLOAT_POINT_COMPENSATION uses the floating point ones
+void bme680_compensate(Bme680_Device* device, Bme680_RawData* raw, Bme680_Measurement* measurement);
+
+#endif // _BME680_H
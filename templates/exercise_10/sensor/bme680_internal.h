@@ -0,0 +1,71 @@
+#ifndef _BME680_INTERNAL_H
+#define _BME680_INTERNAL_H
+
+#include <stdint.h>
+#include "bme680.h"
+
+#define BME680_REGISTER_FIELD0 0x1D
+#define BME680_REGISTER_CONTROL_GAS_0 0x70
+#define BME680_REGISTER_CONTROL_GAS_1 0x71
+#define BME680_REGISTER_CONTROL_HUMIDITY 0x72
+#define BME680_REGISTER_CONTROL_MEASURE 0x74
+#define BME680_REGISTER_CONFIG 0x75
+#define BME680_REGISTER_CALIBRATION_1 0x8A
+#define BME680_REGISTER_CHIP_ID 0xD0
+#define BME680_REGISTER_RESET 0xE0
+#define BME680_REGISTER_CALIBRATION_2 0xE1
+
+#define BME680_CHIP_ID 0x61
+#define BME680_RESET_COMMAND 0xB6
+#define BME680_RESET_MS 10
+#define BME680_HEATER_OFF 0x08
+#define BME680_MODE_FORCED 0x01
+#define BME680_STATUS_NEW_DATA 0x80
+
+#define BME680_SHIFT_OVERSAMPLING_TEMPERATURE 5
+#define BME680_SHIFT_OVERSAMPLING_PRESSURE 2
+#define BME680_SHIFT_FILTER 2
+
+//Conversion time of the datasheet: 1963us per oversampling cycle, switching between the measurements, gas and wake-up
+#define BME680_CYCLE_US 1963UL
+#define BME680_MEASUREMENT_OVERHEAD_US (477UL * 4 + 477UL * 5 + 1000UL)
+
+//Byte positions in field 0
+#define BME680_FIELD_STATUS 0
+#define BME680_FIELD_PRESSURE 2
+#define BME680_FIELD_TEMPERATURE 5
+#define BME680_FIELD_HUMIDITY 8
+
+//Calibration bytes, 23 from BME680_REGISTER_CALIBRATION_1 followed by 10 from BME680_REGISTER_CALIBRATION_2
+#define BME680_CALIBRATION_1_LENGTH 23
+#define BME680_CALIBRATION_2_LENGTH 10
+#define BME680_CALIBRATION_T2 0
+#define BME680_CALIBRATION_T3 2
+#define BME680_CALIBRATION_P1 4
+#define BME680_CALIBRATION_P2 6
+#define BME680_CALIBRATION_P3 8
+#define BME680_CALIBRATION_P4 10
+#define BME680_CALIBRATION_P5 12
+#define BME680_CALIBRATION_P7 14
+#define BME680_CALIBRATION_P6 15
+#define BME680_CALIBRATION_P8 18
+#define BME680_CALIBRATION_P9 20
+#define BME680_CALIBRATION_P10 22
+#define BME680_CALIBRATION_H2_MSB 23
+#define BME680_CALIBRATION_H1_H2_LSB 24 //low nibble belongs to h1, high nibble to h2
+#define BME680_CALIBRATION_H1_MSB 25
+#define BME680_CALIBRATION_H3 26
+#define BME680_CALIBRATION_H4 27
+#define BME680_CALIBRATION_H5 28
+#define BME680_CALIBRATION_H6 29
+#define BME680_CALIBRATION_H7 30
+#define BME680_CALIBRATION_T1 31
+
+uint8_t bme680Internal_transfer(Bme680_Device* device, uint8_t registerAddress, uint8_t* txBuffer, uint16_t txLength, uint8_t* rxBuffer, uint16_t rxLength);
+uint8_t bme680Internal_writeRegister(Bme680_Device* device, uint8_t registerAddress, uint8_t value);
+void bme680Internal_prepareTransaction(Bme680_Device* device, I2C_Transaction* transaction, uint8_t registerAddress);
+void bme680Internal_decodeCalibration(Bme680_Calibration* calibration, uint8_t* data);
+uint32_t bme680Internal_getOversamplingCycles(uint8_t oversampling);
+uint32_t bme680Internal_readAdc20(uint8_t* data);
+
+#endif // _BME680_INTERNAL_H
@@ -0,0 +1,165 @@
+#ifdef INTEGRATION_BME680
+
+#include "sensorPipeline.h"
+#include "sensorPipeline_internal.h"
+
+#include "i2cInterface.h"
+#include "delayAbstraction.h"
+#include "scheduler.h"
+
+#if SENSORPIPELINE_RING_SIZE & (SENSORPIPELINE_RING_SIZE - 1)
+#error "SENSORPIPELINE_RING_SIZE has to be a power of two"
+#endif
+
+SensorPipeline_Sample sensorPipelineRing[SENSORPIPELINE_RING_SIZE];
+uint16_t sensorPipelineWritten = 0; //samples pushed so far, the cursors compare against it
+
+I2C_Transaction sensorPipelineTransaction;
+uint8_t sensorPipelineState = SENSORPIPELINE_STATE_IDLE;
+uint32_t sensorPipelineTriggerMicros;
+uint8_t sensorPipelinePolls;
+SensorPipeline_Statistics sensorPipelineStatistics;
+
+uint8_t sensorPipeline_start(Bme680_Device* device, uint32_t periodMicros){
+	if(device == 0){
+		return SCHEDULER_INVALID_TASK;
+	}
+	sensorPipelineState = SENSORPIPELINE_STATE_IDLE;
+	return scheduler_addPeriodicTask(sensorPipelineInternal_task, device, periodMicros, 0);
+}
+
+void sensorPipeline_openCursor(SensorPipeline_Cursor* cursor){
+	cursor->next = sensorPipelineWritten;
+	cursor->lost = 0;
+}
+
+uint8_t sensorPipeline_read(SensorPipeline_Cursor* cursor, SensorPipeline_Sample* sample){
+	uint16_t available = sensorPipelineWritten - cursor->next;
+	if(available == 0){
+		return 0;
+	}
+	//a consumer that fell behind continues with the oldest sample still in the ring
+	if(available > SENSORPIPELINE_RING_SIZE){
+		cursor->lost += available - SENSORPIPELINE_RING_SIZE;
+		cursor->next = sensorPipelineWritten - SENSORPIPELINE_RING_SIZE;
+	}
+	*sample = sensorPipelineRing[cursor->next & (SENSORPIPELINE_RING_SIZE - 1)];
+	cursor->next++;
+	return 1;
+}
+
+uint8_t sensorPipeline_getLatest(SensorPipeline_Sample* sample){
+	if(sensorPipelineWritten == 0){
+		return 0;
+	}
+	*sample = sensorPipelineRing[(sensorPipelineWritten - 1) & (SENSORPIPELINE_RING_SIZE - 1)];
+	return 1;
+}
+
+void sensorPipeline_getStatistics(SensorPipeline_Statistics* statistics){
+	*statistics = sensorPipelineStatistics;
+}
+
+//##################################
+//Internal applications
+
+//One step per run, the task waits for the bus or the sensor through the scheduler in between
+void sensorPipelineInternal_task(void* argument){
+	Bme680_Device* device = (Bme680_Device*)argument;
+	uint8_t taskId = scheduler_getCurrentTask();
+	uint8_t errorcode;
+	switch(sensorPipelineState){
+		case SENSORPIPELINE_STATE_IDLE:
+			sensorPipelineTriggerMicros = delayAbstraction_nowMicros();
+			sensorPipelinePolls = 0;
+			errorcode = bme680_startMeasurement(device, &sensorPipelineTransaction);
+			if(errorcode){
+				sensorPipelineInternal_fail(errorcode);
+				return;
+			}
+			sensorPipelineState = SENSORPIPELINE_STATE_TRIGGERING;
+			scheduler_waitForEvent(taskId, &sensorPipelineTransaction.state, I2C_TRANSACTION_STATE_DONE, SENSORPIPELINE_TRANSFER_CHECK_US);
+			break;
+		case SENSORPIPELINE_STATE_TRIGGERING:
+			if(!sensorPipelineInternal_isTransferDone(taskId)){
+				return;
+			}
+			if(sensorPipelineTransaction.errorcode){
+				sensorPipelineInternal_fail(sensorPipelineTransaction.errorcode);
+				return;
+			}
+			//the conversion started with the end of the write
+			sensorPipelineState = SENSORPIPELINE_STATE_CONVERTING;
+			scheduler_delayTask(taskId, bme680_getMeasurementMicros(device));
+			break;
+		case SENSORPIPELINE_STATE_CONVERTING:
+			errorcode = bme680_startFieldRead(device, &sensorPipelineTransaction);
+			if(errorcode){
+				sensorPipelineInternal_fail(errorcode);
+				return;
+			}
+			sensorPipelineState = SENSORPIPELINE_STATE_READING;
+			scheduler_waitForEvent(taskId, &sensorPipelineTransaction.state, I2C_TRANSACTION_STATE_DONE, SENSORPIPELINE_TRANSFER_CHECK_US);
+			break;
+		case SENSORPIPELINE_STATE_READING:{
+			if(!sensorPipelineInternal_isTransferDone(taskId)){
+				return;
+			}
+			if(sensorPipelineTransaction.errorcode){
+				sensorPipelineInternal_fail(sensorPipelineTransaction.errorcode);
+				return;
+			}
+			Bme680_RawData raw;
+			if(!bme680_getRawData(device, &raw)){
+				sensorPipelineStatistics.notReady++;
+				if(++sensorPipelinePolls >= SENSORPIPELINE_MAX_POLLS){
+					sensorPipelineInternal_fail(I2C_CODES_NO_ERROR);
+					return;
+				}
+				sensorPipelineState = SENSORPIPELINE_STATE_CONVERTING;
+				scheduler_delayTask(taskId, SENSORPIPELINE_POLL_US);
+				return;
+			}
+			Bme680_Measurement measurement;
+			bme680_compensate(device, &raw, &measurement);
+			sensorPipelineInternal_push(&measurement);
+			sensorPipelineState = SENSORPIPELINE_STATE_IDLE;
+			break;
+		}
+		default:
+			sensorPipelineState = SENSORPIPELINE_STATE_IDLE;
+			break;
+	}
+}
+
+//Nothing services the timeout of an asynchronous transfer while nobody waits on it, the task does it when woken early
+uint8_t sensorPipelineInternal_isTransferDone(uint8_t taskId){
+	if(sensorPipelineTransaction.state != I2C_TRANSACTION_STATE_DONE){
+		i2c_checkTimeout();
+	}
+	if(sensorPipelineTransaction.state == I2C_TRANSACTION_STATE_DONE){
+		return 1;
+	}
+	scheduler_waitForEvent(taskId, &sensorPipelineTransaction.state, I2C_TRANSACTION_STATE_DONE, SENSORPIPELINE_TRANSFER_CHECK_US);
+	return 0;
+}
+
+//The measurement is given up, the next release starts a new one
+void sensorPipelineInternal_fail(uint8_t errorcode){
+	sensorPipelineStatistics.failed++;
+	if(errorcode){
+		sensorPipelineStatistics.lastError = errorcode;
+	}
+	sensorPipelineState = SENSORPIPELINE_STATE_IDLE;
+}
+
+void sensorPipelineInternal_push(Bme680_Measurement* measurement){
+	SensorPipeline_Sample* sample = &sensorPipelineRing[sensorPipelineWritten & (SENSORPIPELINE_RING_SIZE - 1)];
+	sample->timestampMicros = sensorPipelineTriggerMicros;
+	sample->sequence = sensorPipelineWritten;
+	sample->measurement = *measurement;
+	sensorPipelineWritten++;
+	sensorPipelineStatistics.samples++;
+}
+
+#endif // INTEGRATION_BME680
@@ -0,0 +1,49 @@
+#ifndef _SENSORPIPELINE_H
+#define _SENSORPIPELINE_H
+
+#include <stdint.h>
+#include "bme680.h"
+
+//Samples kept for the consumers, a power of two
+#ifndef SENSORPIPELINE_RING_SIZE
+#define SENSORPIPELINE_RING_SIZE 8
+#endif
+
+typedef struct{
+	uint32_t timestampMicros; //when the measurement was triggered
+	uint16_t sequence; //counts every sample, a gap means the consumer missed samples
+	Bme680_Measurement measurement;
+}SensorPipeline_Sample;
+
+//Read position of one consumer, each consumer has its own and reads every sample at its own pace
+typedef struct{
+	uint16_t next;
+	uint16_t lost; //samples overwritten before the consumer read them
+}SensorPipeline_Cursor;
+
+typedef struct{
+	uint32_t samples;
+	uint16_t notReady; //field reads that found the conversion still running
+	uint16_t failed; //measurements given up after a transfer error or too many reads
+	uint8_t lastError; //I2C_CODES_* of the last failed transfer
+}SensorPipeline_Statistics;
+
+/*
+	Acquisition of the BME680 from a periodic scheduler task: every release triggers a forced-mode measurement,
+	the task sleeps for the conversion time and burst-reads the results, all without blocking on the bus.
+	The release times stay on the period however long the conversion and the other tasks take.
+	The samples are timestamped into a ring that consumers such as the display and the UART read through
+	their own cursors. The ring is only touched from tasks, no interrupt writes it.
+
+	Returns the task id of the pipeline, SCHEDULER_INVALID_TASK when the scheduler is full.
+	The device has to be set up with bme680_initialise.
+*/
+uint8_t sensorPipeline_start(Bme680_Device* device, uint32_t periodMicros);
+//A new cursor starts at the next sample
+void sensorPipeline_openCursor(SensorPipeline_Cursor* cursor);
+//Oldest sample the consumer has not read yet, returns 0 when there is none
+uint8_t sensorPipeline_read(SensorPipeline_Cursor* cursor, SensorPipeline_Sample* sample);
+uint8_t sensorPipeline_getLatest(SensorPipeline_Sample* sample);
+void sensorPipeline_getStatistics(SensorPipeline_Statistics* statistics);
+
+#endif // _SENSORPIPELINE_H
@@ -0,0 +1,23 @@
+#ifndef _SENSORPIPELINE_INTERNAL_H
+#define _SENSORPIPELINE_INTERNAL_H
+
+#include <stdint.h>
+#include "sensorPipeline.h"
+
+#define SENSORPIPELINE_STATE_IDLE 0
+#define SENSORPIPELINE_STATE_TRIGGERING 1
+#define SENSORPIPELINE_STATE_CONVERTING 2
+#define SENSORPIPELINE_STATE_READING 3
+
+//The task checks a transfer that has not finished after this long, the I2C timeout ends it if the bus is stuck
+#define SENSORPIPELINE_TRANSFER_CHECK_US 1000UL
+//A field read that finds the conversion still running is repeated after this delay, up to the maximum
+#define SENSORPIPELINE_POLL_US 1000UL
+#define SENSORPIPELINE_MAX_POLLS 5
+
+void sensorPipelineInternal_task(void* argument);
+uint8_t sensorPipelineInternal_isTransferDone(uint8_t taskId);
+void sensorPipelineInternal_fail(uint8_t errorcode);
+void sensorPipelineInternal_push(Bme680_Measurement* measurement);
+
+#endif // _SENSORPIPELINE_INTERNAL_H
@@ -0,0 +1,86 @@
+/*! \file Debug_log.c
+ \brief Binary log over the debug UART.
+ */
+#include "Debug_log.h"
+#include "Debug_uart.h"
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+/* sync, length, id and checksum around the arguments */
+#define DEBUG_LOG_FRAME_OVERHEAD 4
+
+#ifndef UART_TX_BUFFERED
+/* set while a frame is being sent, a frame started meanwhile from an interrupt is dropped */
+volatile uint8_t debugLogBusy = 0;
+#endif
+volatile uint16_t debugLogDropped = 0;
+
+void debugLog_write(DebugLog_Id id, const void* arguments, uint8_t length) {
+	const uint8_t* bytes = arguments;
+	if (length > DEBUG_LOG_MAX_ARGUMENT_BYTES) {
+		length = DEBUG_LOG_MAX_ARGUMENT_BYTES;
+	}
+	uint8_t frame[DEBUG_LOG_MAX_ARGUMENT_BYTES + DEBUG_LOG_FRAME_OVERHEAD];
+	uint8_t frameLength = length + 1;
+	uint8_t checksum = frameLength ^ (uint8_t)id;
+	frame[0] = DEBUG_LOG_SYNC;
+	frame[1] = frameLength;
+	frame[2] = (uint8_t)id;
+	for (uint8_t i = 0; i < length; ++i) {
+		checksum ^= bytes[i];
+		frame[3 + i] = bytes[i];
+	}
+	frame[3 + length] = checksum;
+
+#ifdef UART_TX_BUFFERED
+	/* the frame goes into the transmit buffer in one piece, interrupts are only off for the copy */
+	uart_transmitBlock(frame, length + DEBUG_LOG_FRAME_OVERHEAD);
+#else
+	/* the transmitter is polled with interrupts enabled, the flag keeps the frames apart */
+	char cSREG = SREG;
+	cli();
+	uint8_t busy = debugLogBusy;
+	debugLogBusy = 1;
+	if (busy) {
+		debugLogDropped++;
+	}
+	SREG = cSREG;
+	if (busy) {
+		return;
+	}
+	for (uint8_t i = 0; i < length + DEBUG_LOG_FRAME_OVERHEAD; ++i) {
+		uart_transmit(frame[i]);
+	}
+	debugLogBusy = 0;
+#endif
+}
+
+uint16_t debugLog_getDroppedCount(void) {
+	char cSREG = SREG;
+	cli();
+	uint16_t dropped = debugLogDropped;
+	SREG = cSREG;
+	return dropped;
+}
+
+void debugLog_event(DebugLog_Id id) {
+	debugLog_write(id, 0, 0);
+}
+
+void debugLog_event8(DebugLog_Id id, uint8_t value) {
+	debugLog_write(id, &value, sizeof(value));
+}
+
+void debugLog_event16(DebugLog_Id id, uint16_t value) {
+	debugLog_write(id, &value, sizeof(value));
+}
+
+void debugLog_event16x2(DebugLog_Id id, uint16_t first, uint16_t second) {
+	uint16_t values[2] = {first, second};
+	debugLog_write(id, values, sizeof(values));
+}
+
+void debugLog_event32(DebugLog_Id id, uint32_t value) {
+	debugLog_write(id, &value, sizeof(value));
+}
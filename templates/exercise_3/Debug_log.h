@@ -0,0 +1,67 @@
+/*! \file Debug_log.h
+\brief Binary log over the debug UART.
+
+Instead of formatting text on the MCU a log call sends one frame:
+
+	DEBUG_LOG_SYNC, length, id, argument bytes..., checksum
+
+length counts the id and the argument bytes, the checksum is the XOR of
+length, id and argument bytes. Arguments are sent raw in little endian
+order, as they are in memory. serial_echo.py turns the frames back into
+text using the formats from Debug_logIds.h, ordinary characters written
+with printf or uart_transmit pass through unchanged.
+*/
+#ifndef DEBUG_LOG_H_
+#define DEBUG_LOG_H_
+
+#include <stdint.h>
+
+#define DEBUG_LOG_SYNC 0xA5
+/*
+ * \brief Largest number of argument bytes in one frame.
+ */
+#define DEBUG_LOG_MAX_ARGUMENT_BYTES 16
+
+typedef enum{
+#define DEBUG_LOG_MESSAGE(identifier, format) identifier,
+#include "Debug_logIds.h"
+#undef DEBUG_LOG_MESSAGE
+	LOG_NUMBER_OF_IDS
+}DebugLog_Id;
+
+/*! \brief Send a frame with the given argument bytes.
+ *
+ * The frame is built on the stack first. With UART_TX_BUFFERED it is
+ * copied into the transmit buffer in one piece, interrupts are only
+ * disabled for the copy. Without it the transmitter is polled with
+ * interrupts enabled, a frame logged from an interrupt handler while
+ * another frame is going out is dropped and counted, so frames never
+ * interleave. Arguments above DEBUG_LOG_MAX_ARGUMENT_BYTES are cut off.
+ */
+void debugLog_write(DebugLog_Id id, const void* arguments, uint8_t length);
+
+/*! \brief Frames dropped because they were logged while another frame was sent.
+ */
+uint16_t debugLog_getDroppedCount(void);
+
+/*! \brief Send a frame without arguments.
+ */
+void debugLog_event(DebugLog_Id id);
+
+/*! \brief Send a frame with one 8 bit argument, for %hhu, %hhd and %c.
+ */
+void debugLog_event8(DebugLog_Id id, uint8_t value);
+
+/*! \brief Send a frame with one 16 bit argument, for %u, %d and %x.
+ */
+void debugLog_event16(DebugLog_Id id, uint16_t value);
+
+/*! \brief Send a frame with two 16 bit arguments.
+ */
+void debugLog_event16x2(DebugLog_Id id, uint16_t first, uint16_t second);
+
+/*! \brief Send a frame with one 32 bit argument, for %lu, %ld and %lx.
+ */
+void debugLog_event32(DebugLog_Id id, uint32_t value);
+
+#endif /* DEBUG_LOG_H_ */
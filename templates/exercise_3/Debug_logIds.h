@@ -0,0 +1,18 @@
+/*! \file Debug_logIds.h
+\brief Message table for the binary log.
+
+Every entry is DEBUG_LOG_MESSAGE(identifier, format string). The identifier
+becomes a DebugLog_Id, numbered in the order of this file starting at 0.
+The format is only compiled into serial_echo.py, never into the target:
+it decodes the argument bytes of a frame with it. Argument sizes follow
+avr-gcc: %hhu/%hhd/%c 1 byte, %u/%d/%x 2 bytes, %lu/%ld/%lx 4 bytes,
+%f 4 byte float. Append new messages at the end so old captures stay
+readable.
+
+No include guard, the file is included once per expansion.
+*/
+
+DEBUG_LOG_MESSAGE(LOG_UART_STARTED, "started UART")
+DEBUG_LOG_MESSAGE(LOG_STARTUP_COMPLETE, "\n\n########Startup complete########")
+DEBUG_LOG_MESSAGE(LOG_HELLO_WORLD, "Hello world!")
+DEBUG_LOG_MESSAGE(LOG_UART_TX_DROPPED, "uart dropped %u characters")
@@ -4,6 +4,8 @@
 #include "Debug_uart.h"
 
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <avr/io.h>
@@ -17,6 +19,144 @@
 
 #define SCHEDULER_UBRR (F_CPU/16/BAUD-1)
 
+#ifdef UART_TX_BUFFERED
+#if (UART_TX_BUFSIZE & (UART_TX_BUFSIZE - 1)) || UART_TX_BUFSIZE > 128
+#error "UART_TX_BUFSIZE must be a power of two, at most 128"
+#endif
+#define UART_TX_BUFMASK (UART_TX_BUFSIZE - 1)
+
+volatile unsigned char uartTxBuffer[UART_TX_BUFSIZE];
+volatile uint8_t uartTxHead = 0;
+volatile uint8_t uartTxTail = 0;
+#endif
+
+#if (UART_RX_RINGSIZE & (UART_RX_RINGSIZE - 1)) || UART_RX_RINGSIZE > 128
+#error "UART_RX_RINGSIZE must be a power of two, at most 128"
+#endif
+#define UART_RX_RINGMASK (UART_RX_RINGSIZE - 1)
+
+volatile unsigned char uartRxRing[UART_RX_RINGSIZE];
+volatile uint8_t uartRxHead = 0;
+volatile uint8_t uartRxTail = 0;
+/* FE0, DOR0 and UPE0 bits seen by the Rx interrupt, DOR0 also marks a full ring */
+volatile uint8_t uartRxErrors = 0;
+
+volatile uint16_t uartTxDropped = 0;
+volatile uint8_t uartTxPending = 0;
+
+/*
+ * Enter IDLE sleep, called with interrupts disabled after the wait condition
+ * was checked. sei and the sleep instruction run back to back, so the
+ * interrupt that ends the wait always ends the sleep.
+ */
+static void uart_sleepCpu(void) {
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	sleep_enable();
+	sei();
+	sleep_cpu();
+	sleep_disable();
+}
+
+/*
+ * Wait in IDLE sleep until an interrupt moved the index away from value.
+ * With POWER_BUSY_WAIT or with interrupts disabled it returns at once and
+ * the caller spins.
+ */
+static void uart_sleepWhileEqual(volatile uint8_t *index, uint8_t value) {
+#ifndef POWER_BUSY_WAIT
+	if (!(SREG & (1 << SREG_I)))
+		return;
+	cli();
+	if (*index == value)
+		uart_sleepCpu();
+	sei();
+#endif
+}
+
+/*
+ * Write one character to UDR0 and clear TXC0, so uart_flush can wait for
+ * the end of the last frame.
+ */
+static void uart_writeDataRegister(unsigned char data) {
+	UCSR0A = (UCSR0A & ((1 << U2X0) | (1 << MPCM0))) | (1 << TXC0);
+	UDR0 = data;
+	uartTxPending = 1;
+}
+
+#ifdef UART_TX_BUFFERED
+/*
+ * Move the oldest queued character to the transmitter by hand. Used when
+ * the buffer is full while global interrupts are disabled.
+ */
+static void uart_txDrainOne(void) {
+	loop_until_bit_is_set(UCSR0A, UDRE0);
+	uart_writeDataRegister(uartTxBuffer[uartTxTail]);
+	uartTxTail = (uartTxTail + 1) & UART_TX_BUFMASK;
+}
+
+static void uart_txEnqueue(unsigned char data) {
+	uint8_t nextHead = (uartTxHead + 1) & UART_TX_BUFMASK;
+#if UART_TX_OVERFLOW_POLICY == UART_TX_OVERFLOW_DROP_NEWEST
+	if (nextHead == uartTxTail) {
+		uartTxDropped++;
+		return;
+	}
+#elif UART_TX_OVERFLOW_POLICY == UART_TX_OVERFLOW_DROP_OLDEST
+	char cSREG = SREG;
+	cli();
+	if (nextHead == uartTxTail) {
+		uartTxTail = (uartTxTail + 1) & UART_TX_BUFMASK;
+		uartTxDropped++;
+	}
+	SREG = cSREG;
+#else
+	while (nextHead == uartTxTail) {
+		if (!(SREG & (1 << SREG_I)))
+			uart_txDrainOne();
+		else
+			uart_sleepWhileEqual(&uartTxTail, nextHead);
+	}
+#endif
+	uartTxBuffer[uartTxHead] = data;
+	uartTxHead = nextHead;
+	UCSR0B |= (1 << UDRIE0);
+}
+
+ISR(USART_UDRE_vect) {
+	uart_writeDataRegister(uartTxBuffer[uartTxTail]);
+	uartTxTail = (uartTxTail + 1) & UART_TX_BUFMASK;
+	if (uartTxTail == uartTxHead)
+		UCSR0B &= ~(1 << UDRIE0);
+}
+#else
+/*
+ * Wait in IDLE sleep until the data register is empty. The interrupt only
+ * ends the sleep and masks itself again, the caller checks UDRE0.
+ */
+static void uart_sleepUntilDataRegisterEmpty(void) {
+#ifndef POWER_BUSY_WAIT
+	if (!(SREG & (1 << SREG_I)))
+		return;
+	cli();
+	if (!(UCSR0A & (1 << UDRE0))) {
+		UCSR0B |= (1 << UDRIE0);
+		uart_sleepCpu();
+	}
+	sei();
+#endif
+}
+
+ISR(USART_UDRE_vect) {
+	UCSR0B &= ~(1 << UDRIE0);
+}
+#endif
+
+/* End of the last frame, TXC0 is cleared by this interrupt */
+ISR(USART_TX_vect) {
+	UCSR0B &= ~(1 << TXCIE0);
+	uartTxPending = 0;
+}
+
 void uart_init() {
 	char cSREG = SREG;
 	cli();
@@ -30,47 +170,140 @@ void uart_init() {
 }
 
 void uart_transmit(unsigned char data) {
+#ifdef UART_TX_BUFFERED
+	uart_txEnqueue(data);
+#else
 	/* Wait for empty transmit buffer */
 	while (!( UCSR0A & (1 << UDRE0)))
-		;
+		uart_sleepUntilDataRegisterEmpty();
 	/* Put data into buffer, sends the data */
-	UDR0 = data;
+	uart_writeDataRegister(data);
+#endif
 }
+void uart_transmitBlock(const unsigned char *data, uint8_t length) {
+#ifdef UART_TX_BUFFERED
+	if (length < UART_TX_BUFSIZE) {
+		while (1) {
+			char cSREG = SREG;
+			cli();
+			uint8_t room = (uartTxTail - uartTxHead - 1) & UART_TX_BUFMASK;
+			if (room < length) {
+#if UART_TX_OVERFLOW_POLICY == UART_TX_OVERFLOW_DROP_NEWEST
+				uartTxDropped += length;
+				SREG = cSREG;
+				return;
+#elif UART_TX_OVERFLOW_POLICY == UART_TX_OVERFLOW_DROP_OLDEST
+				uartTxTail = (uartTxTail + length - room) & UART_TX_BUFMASK;
+				uartTxDropped += length - room;
+#else
+				uint8_t tail = uartTxTail;
+				SREG = cSREG;
+				if (!(SREG & (1 << SREG_I)))
+					uart_txDrainOne();
+				else
+					uart_sleepWhileEqual(&uartTxTail, tail);
+				continue;
+#endif
+			}
+			for (uint8_t i = 0; i < length; ++i) {
+				uartTxBuffer[uartTxHead] = data[i];
+				uartTxHead = (uartTxHead + 1) & UART_TX_BUFMASK;
+			}
+			UCSR0B |= (1 << UDRIE0);
+			SREG = cSREG;
+			return;
+		}
+	}
+#endif
+	for (uint8_t i = 0; i < length; ++i)
+		uart_transmit(data[i]);
+}
+
 unsigned char uart_receive(void) {
-	/* Wait for data to be received */
-	while (!(UCSR0A & (1 << RXC0)))
-		;
-	/* Get and return received data from buffer */
-	return UDR0;
+	unsigned char data;
+	/* Wait for data to be received by the Rx interrupt */
+	while (uartRxTail == uartRxHead)
+		uart_sleepWhileEqual(&uartRxHead, uartRxTail);
+	data = uartRxRing[uartRxTail];
+	uartRxTail = (uartRxTail + 1) & UART_RX_RINGMASK;
+	return data;
+}
+
+uint8_t uart_rxAvailable(void) {
+	return (uartRxHead - uartRxTail) & UART_RX_RINGMASK;
+}
+
+ISR(USART_RX_vect) {
+	/* the status bits belong to the character in UDR0, read them first */
+	uint8_t status = UCSR0A & (_BV(FE0) | _BV(DOR0) | _BV(UPE0));
+	unsigned char data = UDR0;
+	uint8_t nextHead = (uartRxHead + 1) & UART_RX_RINGMASK;
+
+	if (nextHead == uartRxTail) {
+		uartRxErrors |= _BV(DOR0);
+		return;
+	}
+	uartRxErrors |= status;
+	uartRxRing[uartRxHead] = data;
+	uartRxHead = nextHead;
 }
 
-//void uart_flush(void) {
-//	unsigned char dummy;
-//	dummy = 0;
-//	while ( UCSR1A & (1 << RXC1)) {
-//		dummy = UDR1;
-//	}
-//}
+void uart_flush(void) {
+#ifdef UART_TX_BUFFERED
+	while (uartTxTail != uartTxHead) {
+		uint8_t tail = uartTxTail;
+		if (!(SREG & (1 << SREG_I)))
+			uart_txDrainOne();
+		else
+			uart_sleepWhileEqual(&uartTxTail, tail);
+	}
+#endif
+	/* Wait until the last frame has been shifted out */
+	if (!uartTxPending)
+		return;
+	if (!(SREG & (1 << SREG_I))) {
+		loop_until_bit_is_set(UCSR0A, TXC0);
+		uartTxPending = 0;
+		return;
+	}
+	UCSR0B |= (1 << TXCIE0);
+	while (uartTxPending)
+		uart_sleepWhileEqual(&uartTxPending, 1);
+}
+
+uint16_t uart_getTxDroppedCount(void) {
+	return uartTxDropped;
+}
 
 /*
- * Send character c down the UART Tx, wait until tx holding register
- * is empty.
+ * Send character c down the UART Tx. Without UART_TX_BUFFERED this waits
+ * until the tx holding register is empty, otherwise the character is
+ * queued for the data register empty interrupt.
  */
 int uart_putchar(char c, FILE *stream) {
 
 	if (c == '\a') {
-		fputs("*ring*\n", stderr);
+		fputs_P(PSTR("*ring*\n"), stderr);
 		return 0;
 	}
 
 	if (c == '\n')
 		uart_putchar('\r', stream);
-	loop_until_bit_is_set(UCSR0A, UDRE0);
-	UDR0 = c;
+	uart_transmit(c);
 
 	return 0;
 }
 
+/*
+ * Read the string byte by byte from flash, nothing of it is copied to RAM.
+ */
+void uart_puts_P(const char *string) {
+	char c;
+
+	while ((c = pgm_read_byte(string++)))
+		uart_putchar(c, 0);
+}
+
 int uart_printf(char var, FILE *stream) {
 #ifdef PRINT
 	if (var == '\n')
@@ -94,11 +327,14 @@ int uart_printf(char var, FILE *stream) {
  */
 
 
- // * Receive a character from the UART Rx.
+ // * Collect a line from the characters the Rx interrupt buffered so far.
  // *
  // * This features a simple line-editor that allows to delete and
  // * re-edit the characters entered, until either CR or NL is entered.
  // * Printable characters entered will be echoed using uart_putchar().
+ // * uart_pollLine() never waits for input: it returns 0 while the line
+ // * is incomplete and the line length once CR or NL arrived, with *line
+ // * pointing to the NUL terminated line (including the \n).
  // *
  // * Editing characters:
  // *
@@ -118,88 +354,115 @@ int uart_printf(char var, FILE *stream) {
  // * allowed.
  // *
  // * Input errors while talking to the UART will cause an immediate
- // * return of -1 (error indication).  Notably, this will be caused by a
- // * framing error (e. g. serial line "break" condition), by an input
- // * overrun, and by a parity error (if parity was enabled and automatic
- // * parity recognition is supported by hardware).
+ // * return of a negative value (error indication) and discard the
+ // * line.  Notably, this will be caused by a framing error (e. g. serial
+ // * line "break" condition), by an input overrun of the hardware or of
+ // * the Rx ring buffer, and by a parity error (if parity was enabled and
+ // * automatic parity recognition is supported by hardware).
  // *
- // * Successive calls to uart_getchar() will be satisfied from the
- // * internal buffer until that buffer is emptied again.
+ // * uart_getchar() polls for a complete line and then satisfies
+ // * successive calls from that line until it is emptied again.
  
 
-int uart_getchar(FILE *stream) {
+int uart_pollLine(FILE *stream, const char **line) {
 	uint8_t c;
-	char *cp, *cp2;
-	static char b[RX_BUFSIZE];
-	static char *rxp;
+	char *cp2;
+	static char b[RX_BUFSIZE + 1];
+	static char *cp = b;
+	uint8_t errors;
 
-	if (rxp == 0)
-		for (cp = b;;) {
-			loop_until_bit_is_set(UCSR0A, RXC0);
-			if (UCSR0A & _BV(FE0))
+	/* a line returned by the previous call has been handed out, start a new one */
+	if (cp > b && cp[-1] == '\n')
+		cp = b;
+
+	while (uartRxTail != uartRxHead) {
+		errors = uartRxErrors;
+		if (errors) {
+			uartRxErrors = 0;
+			cp = b;
+			if (errors & _BV(FE0))
 				return _FDEV_EOF;
-			if (UCSR0A & _BV(DOR0))
-				return _FDEV_ERR;
-			c = UDR0;
-			/* behaviour similar to Unix stty ICRNL */
-			if (c == '\r')
-				c = '\n';
-			if (c == '\n') {
-				*cp = c;
+			return _FDEV_ERR;
+		}
+		c = uartRxRing[uartRxTail];
+		uartRxTail = (uartRxTail + 1) & UART_RX_RINGMASK;
+
+		/* behaviour similar to Unix stty ICRNL */
+		if (c == '\r')
+			c = '\n';
+		if (c == '\n') {
+			*cp++ = c;
+			*cp = '\0';
+			uart_putchar(c, stream);
+			*line = b;
+			return cp - b;
+		} else if (c == '\t')
+			c = ' ';
+
+		if ((c >= (uint8_t) ' ' && c <= (uint8_t) '\x7e') || c >= (uint8_t) '\xa0') {
+			if (cp == b + RX_BUFSIZE - 1)
+				uart_putchar('\a', stream);
+			else {
+				*cp++ = c;
 				uart_putchar(c, stream);
-				rxp = b;
-				break;
-			} else if (c == '\t')
-				c = ' ';
-
-			if ((c >= (uint8_t) ' ' && c <= (uint8_t) '\x7e') || c >= (uint8_t) '\xa0') {
-				if (cp == b + RX_BUFSIZE - 1)
-					uart_putchar('\a', stream);
-				else {
-					*cp++ = c;
-					uart_putchar(c, stream);
-				}
-				continue;
 			}
+			continue;
+		}
 
-			switch (c) {
-			case 'c' & 0x1f:
-				return -1;
-
-			case '\b':
-			case '\x7f':
-				if (cp > b) {
-					uart_putchar('\b', stream);
-					uart_putchar(' ', stream);
-					uart_putchar('\b', stream);
-					cp--;
-				}
-				break;
-
-			case 'r' & 0x1f:
-				uart_putchar('\r', stream);
-				for (cp2 = b; cp2 < cp; cp2++)
-					uart_putchar(*cp2, stream);
-				break;
-
-			case 'u' & 0x1f:
-				while (cp > b) {
-					uart_putchar('\b', stream);
-					uart_putchar(' ', stream);
-					uart_putchar('\b', stream);
-					cp--;
-				}
-				break;
-
-			case 'w' & 0x1f:
-				while (cp > b && cp[-1] != ' ') {
-					uart_putchar('\b', stream);
-					uart_putchar(' ', stream);
-					uart_putchar('\b', stream);
-					cp--;
-				}
-				break;
+		switch (c) {
+		case 'c' & 0x1f:
+			cp = b;
+			return -1;
+
+		case '\b':
+		case '\x7f':
+			if (cp > b) {
+				uart_putchar('\b', stream);
+				uart_putchar(' ', stream);
+				uart_putchar('\b', stream);
+				cp--;
 			}
+			break;
+
+		case 'r' & 0x1f:
+			uart_putchar('\r', stream);
+			for (cp2 = b; cp2 < cp; cp2++)
+				uart_putchar(*cp2, stream);
+			break;
+
+		case 'u' & 0x1f:
+			while (cp > b) {
+				uart_putchar('\b', stream);
+				uart_putchar(' ', stream);
+				uart_putchar('\b', stream);
+				cp--;
+			}
+			break;
+
+		case 'w' & 0x1f:
+			while (cp > b && cp[-1] != ' ') {
+				uart_putchar('\b', stream);
+				uart_putchar(' ', stream);
+				uart_putchar('\b', stream);
+				cp--;
+			}
+			break;
+		}
+	}
+	return 0;
+}
+
+int uart_getchar(FILE *stream) {
+	uint8_t c;
+	int status;
+	static const char *rxp;
+
+	if (rxp == 0)
+		while ((status = uart_pollLine(stream, &rxp)) <= 0) {
+			if (status < 0)
+				return status;
+			/* the ring is empty, sleep until the Rx interrupt brings more */
+			uart_sleepWhileEqual(&uartRxHead, uartRxTail);
 		}
 
 	c = *rxp++;
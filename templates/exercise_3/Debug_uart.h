@@ -16,14 +16,58 @@ void uart_init();
  */	
 void uart_transmit(unsigned char data);
 
+/*! \brief Transmit length characters back to back.
+ *
+ * With UART_TX_BUFFERED the block is queued in one piece: nothing another
+ * writer queues ends up in between, interrupts are only disabled while it
+ * is copied. A block that does not fit into the buffer at all is queued
+ * character by character. Without UART_TX_BUFFERED it is the same as
+ * calling uart_transmit for every character.
+ */	
+void uart_transmitBlock(const unsigned char *data, uint8_t length);
+
 /*! \brief return received data from buffer.
  */	
 unsigned char uart_receive(void);
 
-/*! \brief Transmit single character..
+/*! \brief Number of received characters waiting in the Rx ring buffer.
+ */	
+uint8_t uart_rxAvailable(void);
+
+/*
+ * \brief Size of the ring buffer filled by the Rx interrupt, a power of two, at most 128.
+ */
+#ifndef UART_RX_RINGSIZE
+#define UART_RX_RINGSIZE 32
+#endif
+
+/*! \brief Wait until every queued character has left the transmitter.
  */	
 void uart_flush( void );
 
+/*
+ * \brief Interrupt driven transmit buffer, enabled with -DUART_TX_BUFFERED.
+ *
+ * UART_TX_BUFSIZE must be a power of two, at most 128.
+ * UART_TX_OVERFLOW_POLICY decides what happens when the buffer is full:
+ * block until the interrupt made room, drop the new character or drop
+ * the oldest queued character.
+ */
+#define UART_TX_OVERFLOW_BLOCK 0
+#define UART_TX_OVERFLOW_DROP_NEWEST 1
+#define UART_TX_OVERFLOW_DROP_OLDEST 2
+
+#ifndef UART_TX_BUFSIZE
+#define UART_TX_BUFSIZE 64
+#endif
+#ifndef UART_TX_OVERFLOW_POLICY
+#define UART_TX_OVERFLOW_POLICY UART_TX_OVERFLOW_BLOCK
+#endif
+
+/*! \brief Number of characters dropped by the transmit buffer overflow policy.
+ */	
+uint16_t uart_getTxDroppedCount(void);
+
 // ! \brief Send one character to the UART.
  	
 int	uart_putchar(char c, FILE *stream);
@@ -32,6 +76,10 @@ int	uart_putchar(char c, FILE *stream);
  */	
 int uart_printf(char var, FILE *stream);
 
+/*! \brief Send a string that lives in flash (PSTR or PROGMEM), \n goes out as \r\n like uart_putchar.
+ */	
+void uart_puts_P(const char *string);
+
 /*
  * \brief Size of internal line buffer used by uart_getchar().
  */
@@ -43,4 +91,12 @@ int uart_printf(char var, FILE *stream);
  * each invocation.
  */
 int	uart_getchar(FILE *stream);
+
+/*
+ * Run the line editor over the buffered input without waiting. Returns
+ * the length of a completed line and sets *line to it, 0 while the line
+ * is still incomplete, or a negative value on input errors.  Meant to be
+ * called from the main loop every tick.
+ */
+int	uart_pollLine(FILE *stream, const char **line);
 #endif /* UART_H_ */
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include <stdio.h>
+#include <avr/interrupt.h>
 #include "Debug_uart.h"
+#include "Debug_log.h"
 
 static FILE uart_str = FDEV_SETUP_STREAM(uart_putchar, uart_getchar, _FDEV_SETUP_RW);
 void integration_runTempTester(void);
@@ -7,12 +9,14 @@ void integration_runTempTester(void);
 void startUart(void){
 	stdout = stdin = &uart_str;
 	uart_init();
-	printf("started UART\n");
-	printf("\n\n########Startup complete########\n");
+	sei(); //the buffered transmitter and the receiver run from interrupts
+	debugLog_event(LOG_UART_STARTED);
+	debugLog_event(LOG_STARTUP_COMPLETE);
 }
 
 int main( int argc, const char* argv[] ){
 	startUart();
-	printf("Hello world!\n");
+	debugLog_event(LOG_HELLO_WORLD);
+	debugLog_event16(LOG_UART_TX_DROPPED, uart_getTxDroppedCount());
+	uart_flush(); //returning from main disables the interrupts, the queued characters would never leave
 }
-